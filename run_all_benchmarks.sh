@@ -43,6 +43,22 @@ trap restore_settings EXIT INT TERM
 # --- Configuration ---
 BENCHMARK_EXEC="./sqlite_benchmark"
 BENCHMARKS_TO_RUN="fillrandom,readrandom"
+# Optional comma-separated fractions of the loaded database size (e.g. "0.25,0.5,1.0").
+# The binary measures the database after its fill step and re-runs each read benchmark
+# once per fraction, reporting it as e.g. "readrandom@mmap0.50@cache1.00".
+MMAP_FRACTIONS=""
+CACHE_FRACTIONS=""
+# Table layout flags passed to every run, e.g. "--schema=uuid --without_rowid --value_columns=4"
+# or "--indexes=4" (needed by the indexlookup and createindex benchmarks).
+# The default is an INTEGER PRIMARY KEY (rowid alias) with one BLOB value.
+SCHEMA_ARGS=""
+# Value size distribution flags passed to every run; the SIZES value size becomes the mean,
+# e.g. "--value_size_dist=lognormal --value_size_max=65536".
+VALUE_ARGS=""
+# Set to true to record dbstat B-tree depth, pages per level and fill for each table and
+# index after each load phase (from the last run) in each log, labelled dbstat[<phase>].
+# Reading every page adds time and warms the caches for the benchmarks that follow.
+DBSTAT_REPORT=false
 declare -a SIZES=(
     "100MB,25600,4096"
     "1GB,262144,4096"
@@ -52,6 +68,8 @@ declare -a SIZES=(
 )
 declare -a STORAGE_CONFIGS=(
     "memory,:memory:"
+    # A memdb database shared by every connection; needed for in-memory multithreaded benchmarks.
+    # "memdb,file:/bench.db?vfs=memdb"
     "tmpfs,/tmp/test.db"
     "nvme,/db/test.db"
     "pmem,/mnt/pmem/test.db"
@@ -71,6 +89,51 @@ declare -a PRAGMA_CONFIGS=(
     "page_16k,journal_mode=WAL,synchronous=NORMAL,page_size=16384,mmap_size=__MMAP_SIZE__"
     "page_32k,journal_mode=WAL,synchronous=NORMAL,page_size=32768"
     "page_32k_mmap,journal_mode=WAL,synchronous=NORMAL,page_size=32768,mmap_size=__MMAP_SIZE__"
+    "cache_64m,journal_mode=WAL,synchronous=NORMAL,cache_size=-65536"
+    "cache_512m,journal_mode=WAL,synchronous=NORMAL,cache_size=-524288"
+    # Small pager cache; pair with the ramcache VFS to compare cache tiers.
+    # "cache_8m,journal_mode=WAL,synchronous=NORMAL,cache_size=-8192"
+)
+# VFS stacks to compare ("name,--vfs value"). Non-default VFSes only run on file-backed storage.
+declare -a VFS_CONFIGS=(
+    "default,"
+    "io_uring,io_uring"
+    "odirect,odirect"
+    # Emulated storage profiles; their delays are set in VFS_ARGS below.
+    # "cloud_ssd,latency"
+    # "slow_hdd,latency"
+    # Fault injection; pair with the "resilience" benchmark, which retries failed operations.
+    # "flaky_disk,faults"
+    # Page compression; also pass --compression_ratio to the default VFS for a like-for-like baseline.
+    # "compress_zlib,compress"
+    # Write coalescing and a secondary RAM read cache; compare against cache_size and mmap_size setups.
+    # "coalesce,coalesce"
+    # "ramcache,ramcache"
+    # "ramcache_zlib,ramcache"
+    # "tiered,ramcache,coalesce"
+    # Per-page checksums; compare against "default" for the cost of end-to-end page integrity.
+    # "cksum,cksum"
+    # "cksum_compat,cksum"
+    # Files held in process memory with full locking (WAL works); the storage path only names the file.
+    # "ram,ram"
+    # madvise() on SQLite's memory map; only has an effect with the *mmap* PRAGMA setups.
+    # "mmap_random,mmap"
+    # "mmap_sequential,mmap"
+    # "mmap_prefault,mmap"
+)
+# Extra sqlite_benchmark flags per VFS_CONFIGS name.
+declare -A VFS_ARGS=(
+    ["cloud_ssd"]="--latency_read_us=500 --latency_write_us=700 --latency_sync_us=1500 --latency_dist=lognormal --latency_jitter_us=100 --latency_bandwidth_mbps=250"
+    ["slow_hdd"]="--latency_read_us=4000 --latency_write_us=4000 --latency_sync_us=8000 --latency_dist=exponential --latency_bandwidth_mbps=150"
+    ["compress_zlib"]="--compress_codec=zlib --compression_ratio=0.5"
+    ["flaky_disk"]="--fault_busy_prob=0.01 --fault_ioerr_prob=0.001 --fault_full_prob=0.0005"
+    ["ramcache"]="--ramcache_mb=512"
+    ["ramcache_zlib"]="--ramcache_mb=512 --ramcache_codec=zlib"
+    ["tiered"]="--ramcache_mb=512 --coalesce_max_kb=64"
+    ["cksum_compat"]="--cksum_algo=cksumvfs"
+    ["mmap_random"]="--mmap_advice=random"
+    ["mmap_sequential"]="--mmap_advice=sequential"
+    ["mmap_prefault"]="--mmap_advice=prefault"
 )
 THP_PATH="/sys/kernel/mm/transparent_hugepage/enabled"
 
@@ -135,84 +198,121 @@ echo
 NUM_SIZES=${#SIZES[@]}
 NUM_STORAGE=${#STORAGE_CONFIGS[@]}
 NUM_PRAGMAS=${#PRAGMA_CONFIGS[@]}
-TOTAL_JOBS=$((NUM_SIZES * NUM_STORAGE * NUM_PRAGMAS))
+NUM_VFS=${#VFS_CONFIGS[@]}
+TOTAL_JOBS=$((NUM_SIZES * NUM_STORAGE * NUM_PRAGMAS * NUM_VFS))
 CURRENT_JOB=0
 
 for size_config in "${SIZES[@]}"; do
     IFS=',' read -r size_name num_entries value_size <<< "$size_config"
     db_size_bytes=$((num_entries * value_size))
+    # Estimate from the raw value bytes; ignores page overhead and keys. Use MMAP_FRACTIONS
+    # to size against the real file instead.
     mmap_size=$((db_size_bytes + db_size_bytes / 10))
 
     for storage_config in "${STORAGE_CONFIGS[@]}"; do
         IFS=',' read -r storage_name db_path <<< "$storage_config"
-        if [[ "$db_path" != ":memory:" ]] && [ ! -d "$(dirname "$db_path")" ]; then continue; fi
+        in_memory=false
+        [[ "$db_path" == ":memory:" || "$db_path" == file:* ]] && in_memory=true
+        if [[ "$in_memory" == false ]] && [ ! -d "$(dirname "$db_path")" ]; then continue; fi
 
         for pragma_config in "${PRAGMA_CONFIGS[@]}"; do
             IFS=',' read -r pragma_name pragma_template <<< "$pragma_config"
-            if [[ "$storage_name" == "memory" ]] && [[ "$pragma_name" == *"mmap"* ]]; then
+            if [[ "$in_memory" == true ]] && [[ "$pragma_name" == *"mmap"* ]]; then
                 echo "--> SKIPPING mmap test for in-memory database."
                 continue
             fi
 
-            CURRENT_JOB=$((CURRENT_JOB + 1))
-            echo "[${CURRENT_JOB}/${TOTAL_JOBS}] Progress: Running Size=${size_name}, Storage=${storage_name}, PRAGMA=${pragma_name}"
-
-            final_pragma_string="${pragma_template/__MMAP_SIZE__/$mmap_size}"
-            LOG_FILE="${RESULTS_DIR}/${storage_name}_${size_name}_${pragma_name}.log"
-
-            echo "----------------------------------------------------------------"
-            echo "RUNNING: Size=${size_name}, Storage=${storage_name}, PRAGMA=${pragma_name} ($NUM_RUNS times)"
-
-            declare -A ops_sum
-            declare -A run_counts
-
-            for i in $(seq 1 $NUM_RUNS); do
-                echo "    Run $i/$NUM_RUNS..."
-                # Drop caches before each run for consistency
-                echo "    -> Dropping caches..."
-                echo 3 | sudo tee /proc/sys/vm/drop_caches >/dev/null
-
-                command_args=(
-                    "--db_path" "$db_path"
-                    "--num" "$num_entries"
-                    "--value_size" "$value_size"
-                    "--benchmarks" "$BENCHMARKS_TO_RUN"
-                    "--pragmas" "$final_pragma_string"
-                )
-                output=$("$BENCHMARK_EXEC" "${command_args[@]}")
-                while read -r line; do
-                    if [[ "$line" == *"ops/sec"* ]]; then
-                        local_benchmark=$(echo "$line" | awk '{print $1}')
-                        local_ops=$(echo "$line" | awk '{print $3}')
-                        [[ -z "${ops_sum[$local_benchmark]}" ]] && ops_sum[$local_benchmark]=0
-                        [[ -z "${run_counts[$local_benchmark]}" ]] && run_counts[$local_benchmark]=0
-                        ops_sum[$local_benchmark]=$(echo "${ops_sum[$local_benchmark]} + $local_ops" | bc)
-                        run_counts[$local_benchmark]=$((run_counts[$local_benchmark] + 1))
-                    fi
-                done <<< "$output"
-            done
-
-            echo "Averaging results and writing to log: ${LOG_FILE}"
-            {
-              echo "--- Benchmark Configuration ---"
-              echo "Database path: $db_path"
-              echo "Entries:       $num_entries"
-              echo "Value Size:    $value_size bytes"
-              echo "PRAGMAs:       ${final_pragma_string:-[defaults]}"
-              echo "-----------------------------"
-              for benchmark_name in "${!ops_sum[@]}"; do
-                  total_ops=${ops_sum[$benchmark_name]}
-                  count=${run_counts[$benchmark_name]}
-                  if [[ $count -gt 0 ]]; then
-                    average_ops=$(echo "scale=2; $total_ops / $count" | bc)
-                    printf "%-20s: %s ops/sec (averaged over %d runs)\n" "$benchmark_name" "$average_ops" "$count"
+            for vfs_config in "${VFS_CONFIGS[@]}"; do
+                IFS=',' read -r vfs_name vfs_stack <<< "$vfs_config"
+                if [[ "$in_memory" == true ]] && [[ -n "$vfs_stack" ]]; then
+                    echo "--> SKIPPING ${vfs_name} VFS for in-memory database."
+                    continue
+                fi
+                # Fold the VFS into the PRAGMA setup label so the report keeps its columns.
+                setup_name="$pragma_name"
+                [[ -n "$vfs_stack" ]] && setup_name="${pragma_name}@${vfs_name}"
+
+                CURRENT_JOB=$((CURRENT_JOB + 1))
+                echo "[${CURRENT_JOB}/${TOTAL_JOBS}] Progress: Running Size=${size_name}, Storage=${storage_name}, PRAGMA=${setup_name}"
+
+                final_pragma_string="${pragma_template/__MMAP_SIZE__/$mmap_size}"
+                LOG_FILE="${RESULTS_DIR}/${storage_name}_${size_name}_${setup_name}.log"
+
+                echo "----------------------------------------------------------------"
+                echo "RUNNING: Size=${size_name}, Storage=${storage_name}, PRAGMA=${setup_name} ($NUM_RUNS times)"
+
+                # declare -A on an existing array keeps its contents; start each setup empty.
+                unset ops_sum run_counts
+                declare -A ops_sum
+                declare -A run_counts
+
+                for i in $(seq 1 $NUM_RUNS); do
+                    echo "    Run $i/$NUM_RUNS..."
+                    # Drop caches before each run for consistency
+                    echo "    -> Dropping caches..."
+                    echo 3 | sudo tee /proc/sys/vm/drop_caches >/dev/null
+
+                    command_args=(
+                        "--db_path" "$db_path"
+                        "--num" "$num_entries"
+                        "--value_size" "$value_size"
+                        "--benchmarks" "$BENCHMARKS_TO_RUN"
+                        "--pragmas" "$final_pragma_string"
+                        "--vfs" "${vfs_stack:-default}"
+                    )
+                    read -r -a vfs_args <<< "${VFS_ARGS[$vfs_name]}"
+                    command_args+=("${vfs_args[@]}")
+                    read -r -a schema_args <<< "$SCHEMA_ARGS"
+                    command_args+=("${schema_args[@]}")
+                    read -r -a value_args <<< "$VALUE_ARGS"
+                    command_args+=("${value_args[@]}")
+                    [[ -n "$MMAP_FRACTIONS" ]] && command_args+=("--mmap_fraction" "$MMAP_FRACTIONS")
+                    [[ -n "$CACHE_FRACTIONS" ]] && command_args+=("--cache_fraction" "$CACHE_FRACTIONS")
+                    [[ "$DBSTAT_REPORT" == "true" ]] && command_args+=("--dbstat_report")
+                    # A failing run (e.g. an injected fault under the faults VFS) keeps the
+                    # results it printed and must not abort the rest of the suite.
+                    status=0
+                    output=$("$BENCHMARK_EXEC" "${command_args[@]}") || status=$?
+                    [[ $status -ne 0 ]] && echo "    -> WARNING: benchmark exited with status $status"
+                    while read -r line; do
+                        if [[ "$line" == *"ops/sec"* ]]; then
+                            local_benchmark=$(echo "$line" | awk '{print $1}')
+                            local_ops=$(echo "$line" | awk '{print $3}')
+                            [[ -z "${ops_sum[$local_benchmark]}" ]] && ops_sum[$local_benchmark]=0
+                            [[ -z "${run_counts[$local_benchmark]}" ]] && run_counts[$local_benchmark]=0
+                            ops_sum[$local_benchmark]=$(echo "${ops_sum[$local_benchmark]} + $local_ops" | bc)
+                            run_counts[$local_benchmark]=$((run_counts[$local_benchmark] + 1))
+                        fi
+                    done <<< "$output"
+                done
+
+                echo "Averaging results and writing to log: ${LOG_FILE}"
+                {
+                  echo "--- Benchmark Configuration ---"
+                  echo "Database path: $db_path"
+                  echo "Entries:       $num_entries"
+                  echo "Value Size:    $value_size bytes"
+                  echo "VFS:           ${vfs_stack:-default}"
+                  echo "PRAGMAs:       ${final_pragma_string:-[defaults]}"
+                  echo "-----------------------------"
+                  for benchmark_name in "${!ops_sum[@]}"; do
+                      total_ops=${ops_sum[$benchmark_name]}
+                      count=${run_counts[$benchmark_name]}
+                      if [[ $count -gt 0 ]]; then
+                        average_ops=$(echo "scale=2; $total_ops / $count" | bc)
+                        printf "%-19s : %s ops/sec (averaged over %d runs)\n" "$benchmark_name" "$average_ops" "$count"
+                      fi
+                  done
+                  if [[ "$DBSTAT_REPORT" == "true" ]]; then
+                    echo "--- B-tree Layout (dbstat, last run) ---"
+                    grep '^  dbstat' <<< "$output"
                   fi
-              done
-            } > "$LOG_FILE"
+                } > "$LOG_FILE"
 
-            echo "COMPLETED: ${storage_name}_${size_name}_${pragma_name}"
-            echo "----------------------------------------------------------------"
-            echo
+                echo "COMPLETED: ${storage_name}_${size_name}_${setup_name}"
+                echo "----------------------------------------------------------------"
+                echo
+            done
         done
     done
 done
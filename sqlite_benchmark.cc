@@ -3,11 +3,52 @@
 #include <string>
 #include <chrono>
 #include <random>
+#include <thread>
+#include <cmath>
 #include <sstream>
 #include <iomanip>
+#include <map>
+#include <set>
+#include <deque>
+#include <condition_variable>
+#include <list>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#define HAVE_ZLIB 1
+#endif
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING 1
+#endif
+
 // You will need to download cxxopts.hpp from https://github.com/jarro2783/cxxopts
 // It's a header-only library, so just place it in your project directory.
 #include "cxxopts.hpp"
@@ -33,271 +74,6405 @@ std::vector<std::string> split(const std::string& s, char delimiter) {
     while (std::getline(tokenStream, token, delimiter)) {
         tokens.push_back(token);
     }
-    return tokens;
-}
+    return tokens;
+}
+
+// Collects per-operation latencies and summarises them as percentiles.
+class LatencyRecorder {
+public:
+    void reserve(size_t n) { samples_us_.reserve(n); }
+
+    void add(std::chrono::duration<double> d) { samples_us_.push_back(d.count() * 1e6); }
+
+    void merge(const LatencyRecorder& other) {
+        samples_us_.insert(samples_us_.end(), other.samples_us_.begin(), other.samples_us_.end());
+    }
+
+    std::string summary() {
+        if (samples_us_.empty()) return "no samples";
+        std::sort(samples_us_.begin(), samples_us_.end());
+        auto pct = [this](double p) {
+            size_t idx = static_cast<size_t>(p / 100.0 * (samples_us_.size() - 1) + 0.5);
+            return samples_us_[idx];
+        };
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << "p50=" << pct(50) << "us p95=" << pct(95) << "us p99=" << pct(99)
+            << "us p99.9=" << pct(99.9) << "us max=" << samples_us_.back() << "us";
+        return out.str();
+    }
+
+private:
+    std::vector<double> samples_us_;
+};
+
+// A pre-generated, cyclic stream of value sizes drawn from a distribution
+// (--value_size_dist), so a benchmark pays one array read per value:
+//   uniform     between the bounds
+//   normal      mean value_size, standard deviation sigma * value_size
+//   lognormal   mean value_size, sigma the standard deviation of ln(size)
+//   pareto      mean value_size, shape alpha (> 1; smaller is heavier-tailed)
+//   empirical   sampled from a file of "size [weight]" lines
+// Every size is clamped to [min, max].
+class ValueSizes {
+public:
+    static constexpr size_t kStreamLength = 1 << 20;
+
+    // Returns nullptr for "fixed"; exits on an invalid spec.
+    static std::shared_ptr<const ValueSizes> Make(const std::string& spec, int mean, int min, int max, double sigma,
+                                                  double alpha, uint64_t seed) {
+        if (spec == "fixed") return nullptr;
+        auto sizes = std::make_shared<ValueSizes>();
+        std::mt19937_64 rng(seed);
+        std::function<double()> draw;
+        std::uniform_real_distribution<double> unit(0, 1);
+        if (spec == "uniform") {
+            auto dist = std::make_shared<std::uniform_int_distribution<int>>(min, max);
+            draw = [&, dist] { return (*dist)(rng); };
+        } else if (spec == "normal") {
+            auto dist = std::make_shared<std::normal_distribution<double>>(mean, sigma * mean);
+            draw = [&, dist] { return (*dist)(rng); };
+        } else if (spec == "lognormal") {
+            auto dist = std::make_shared<std::lognormal_distribution<double>>(std::log(mean) - sigma * sigma / 2, sigma);
+            draw = [&, dist] { return (*dist)(rng); };
+        } else if (spec == "pareto") {
+            if (alpha <= 1) {
+                std::cerr << "--value_size_alpha must be greater than 1." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            const double scale = mean * (alpha - 1) / alpha;
+            draw = [&, scale] { return scale / std::pow(1 - unit(rng), 1 / alpha); };
+        } else if (spec.compare(0, 10, "empirical:") == 0) {
+            std::ifstream in(spec.substr(10));
+            std::vector<double> values, weights;
+            std::string line;
+            while (std::getline(in, line)) {
+                std::istringstream fields(line);
+                double size, weight = 1;
+                if (line.empty() || line[0] == '#' || !(fields >> size)) continue;
+                fields >> weight;
+                values.push_back(size);
+                weights.push_back(weight);
+            }
+            if (values.empty()) {
+                std::cerr << "No sizes read from '" << spec.substr(10) << "'." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            auto dist = std::make_shared<std::discrete_distribution<size_t>>(weights.begin(), weights.end());
+            draw = [&, dist, values] { return values[(*dist)(rng)]; };
+        } else {
+            std::cerr << "Unknown value size distribution '" << spec
+                      << "' (use fixed, uniform, normal, lognormal, pareto or empirical:<file>)." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        sizes->name_ = spec;
+        sizes->sizes_.resize(kStreamLength);
+        for (auto& s : sizes->sizes_) {
+            s = static_cast<int>(std::clamp<double>(std::llround(draw()), min, max));
+        }
+        sizes->max_ = *std::max_element(sizes->sizes_.begin(), sizes->sizes_.end());
+        return sizes;
+    }
+
+    int at(size_t i) const { return sizes_[i % sizes_.size()]; }
+    int max() const { return max_; }
+
+    std::string describe() const {
+        std::vector<int> sorted = sizes_;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0;
+        for (int s : sorted) sum += s;
+        std::ostringstream out;
+        out << name_ << ", mean " << std::fixed << std::setprecision(0) << sum / sorted.size()
+            << " bytes (min=" << sorted.front() << " p50=" << sorted[sorted.size() / 2]
+            << " p99=" << sorted[sorted.size() * 99 / 100] << " max=" << sorted.back() << ")";
+        return out.str();
+    }
+
+private:
+    std::string name_;
+    std::vector<int> sizes_;
+    int max_ = 0;
+};
+
+// Produces value payloads. With a compression ratio R in (0, 1], values are
+// slices of a pool of random bytes repeated so that they compress to roughly
+// R of their size (the same scheme as LevelDB's db_bench); otherwise every
+// value is the constant |filler| byte. With |sizes|, value lengths follow that
+// stream (starting at a seed-dependent position) instead of |value_size|.
+class ValueGenerator {
+public:
+    struct Value {
+        const char* data;
+        int size;
+    };
+
+    ValueGenerator(int value_size, double compression_ratio, char filler, uint64_t seed,
+                   std::shared_ptr<const ValueSizes> sizes = nullptr)
+        : value_size_(sizes ? sizes->max() : value_size), sizes_(std::move(sizes)), index_(seed % ValueSizes::kStreamLength) {
+        if (compression_ratio <= 0) {
+            data_.assign(value_size_, filler);
+            return;
+        }
+        std::mt19937_64 rng(seed);
+        std::uniform_int_distribution<int> byte_dist(' ', '~');
+        const int kFragment = 100;
+        int raw_len = std::max(1, static_cast<int>(kFragment * std::min(compression_ratio, 1.0)));
+        size_t pool_size = std::max<size_t>(1 << 20, static_cast<size_t>(value_size_) * 4);
+        data_.reserve(pool_size + kFragment);
+        std::string raw(raw_len, ' ');
+        while (data_.size() < pool_size) {
+            for (auto& c : raw) c = static_cast<char>(byte_dist(rng));
+            for (int i = 0; i < kFragment; ++i) data_.push_back(raw[i % raw_len]);
+        }
+        pos_ = 0;
+        sliding_ = true;
+    }
+
+    const char* next() { return nextValue().data; }
+
+    Value nextValue() {
+        const size_t size = sizes_ ? sizes_->at(index_++) : value_size_;
+        if (!sliding_) return {data_.data(), static_cast<int>(size)};
+        if (pos_ + size > data_.size()) pos_ = 0;
+        const char* p = data_.data() + pos_;
+        pos_ += size;
+        return {p, static_cast<int>(size)};
+    }
+
+private:
+    size_t value_size_;  // The largest value.
+    std::shared_ptr<const ValueSizes> sizes_;
+    size_t index_;
+    std::vector<char> data_;
+    size_t pos_ = 0;
+    bool sliding_ = false;
+};
+
+// A generated vocabulary of |vocab| distinct lowercase words (3-10 letters)
+// and documents of |doc_words| words drawn from it with a Zipf distribution:
+// the word of rank r (from 1) has weight 1 / r^s, as in natural text.
+class FtsCorpus {
+public:
+    FtsCorpus(int vocab, double s, int doc_words, uint64_t seed) : doc_words_(std::max(1, doc_words)) {
+        std::mt19937_64 rng(seed);
+        std::uniform_int_distribution<int> length(3, 10), letter('a', 'z');
+        std::set<std::string> seen;
+        while (static_cast<int>(words_.size()) < std::max(1, vocab)) {
+            std::string word(length(rng), ' ');
+            for (auto& c : word) c = static_cast<char>(letter(rng));
+            if (seen.insert(word).second) words_.push_back(std::move(word));
+        }
+        double total = 0;
+        for (size_t r = 1; r <= words_.size(); ++r) cdf_.push_back(total += 1.0 / std::pow(r, s));
+        for (auto& c : cdf_) c /= total;
+    }
+
+    const std::string& word(std::mt19937_64& rng) const {
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        size_t i = std::upper_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin();
+        return words_[std::min(i, words_.size() - 1)];
+    }
+
+    std::string document(std::mt19937_64& rng) const {
+        std::string doc;
+        for (int i = 0; i < doc_words_; ++i) {
+            if (i) doc += ' ';
+            doc += word(rng);
+        }
+        return doc;
+    }
+
+private:
+    std::vector<std::string> words_;  // By rank, most frequent first.
+    std::vector<double> cdf_;
+    int doc_words_;
+};
+
+// LSD radix sort of |items| by their 64-bit |key| member, one byte per pass.
+// Each pass is split across |threads| threads: every thread counts the digits
+// in its slice, a prefix sum over (digit, thread) gives each thread its own
+// output ranges, and the threads scatter in parallel, keeping the sort stable.
+// Passes where every item has the same digit are skipped.
+template <typename T>
+void ParallelRadixSort(std::vector<T>& items, uint64_t T::*key, int threads) {
+    const size_t n = items.size();
+    threads = static_cast<int>(std::max<size_t>(1, std::min<size_t>(threads, n / 65536 + 1)));
+    std::vector<T> scratch(n);
+    std::vector<std::vector<size_t>> counts(threads, std::vector<size_t>(256));
+    auto slice = [&](int t) { return std::make_pair(n * t / threads, n * (t + 1) / threads); };
+    auto parallel = [&](auto fn) {
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threads; ++t) workers.emplace_back(fn, t);
+        fn(0);
+        for (auto& w : workers) w.join();
+    };
+    for (int shift = 0; shift < 64; shift += 8) {
+        parallel([&](int t) {
+            auto [begin, end] = slice(t);
+            std::fill(counts[t].begin(), counts[t].end(), 0);
+            for (size_t i = begin; i < end; ++i) ++counts[t][(items[i].*key >> shift) & 0xff];
+        });
+        size_t offset = 0;
+        bool trivial = false;
+        for (int d = 0; d < 256; ++d) {
+            size_t total = 0;
+            for (int t = 0; t < threads; ++t) total += counts[t][d];
+            if (total == n) trivial = true;
+            for (int t = 0; t < threads; ++t) {
+                size_t c = counts[t][d];
+                counts[t][d] = offset;
+                offset += c;
+            }
+        }
+        if (trivial) continue;
+        parallel([&](int t) {
+            auto [begin, end] = slice(t);
+            for (size_t i = begin; i < end; ++i) scratch[counts[t][(items[i].*key >> shift) & 0xff]++] = items[i];
+        });
+        items.swap(scratch);
+    }
+}
+
+// Buffered output to a file descriptor. Small pieces are copied into a
+// large buffer; pieces of at least kDirect bytes, or too large for the
+// buffer, go out with the buffered bytes in one writev() straight from the
+// caller's memory (e.g. a column value still inside SQLite's page), skipping
+// the copy.
+class ExportWriter {
+public:
+    static constexpr size_t kDirect = 64 * 1024;
+
+    ExportWriter(int fd, size_t buffer_size) : fd_(fd), buffer_(buffer_size) {}
+
+    void append(const void* p, size_t n) {
+        if (n >= kDirect || n > buffer_.size()) {
+            writeAll(p, n);
+            return;
+        }
+        if (len_ + n > buffer_.size()) writeAll(nullptr, 0);
+        memcpy(buffer_.data() + len_, p, n);
+        len_ += n;
+    }
+
+    void put(char c) {
+        if (len_ == buffer_.size()) writeAll(nullptr, 0);
+        buffer_[len_++] = c;
+    }
+
+    void flush() { writeAll(nullptr, 0); }
+
+    uint64_t bytes() const { return bytes_ + len_; }
+    uint64_t writes() const { return writes_; }
+
+private:
+    // Writes the buffer followed by |n| bytes at |p|, retrying short writes.
+    void writeAll(const void* p, size_t n) {
+        struct iovec iov[2] = {{buffer_.data(), len_}, {const_cast<void*>(p), n}};
+        int first = 0;
+        while (iov[0].iov_len + iov[1].iov_len > 0) {
+            if (iov[first].iov_len == 0) ++first;
+            ssize_t written = writev(fd_, iov + first, 2 - first);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                std::cerr << "Export write failed: " << strerror(errno) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            ++writes_;
+            bytes_ += written;
+            for (int i = first; i < 2 && written > 0; ++i) {
+                size_t step = std::min<size_t>(written, iov[i].iov_len);
+                iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + step;
+                iov[i].iov_len -= step;
+                written -= step;
+            }
+        }
+        len_ = 0;
+    }
+
+    int fd_;
+    std::vector<char> buffer_;
+    size_t len_ = 0;
+    uint64_t bytes_ = 0;
+    uint64_t writes_ = 0;
+};
+
+// --- VFS Layers ---
+//
+// Every custom VFS in this tool is a ShimVfs: it registers a sqlite3_vfs that
+// wraps a parent VFS and forwards each call to it, so a layer only overrides
+// the methods it cares about. Layers are stacked with --vfs (outermost first);
+// the innermost one wraps SQLite's default VFS.
+
+class ShimVfs;
+
+struct ShimFile {
+    sqlite3_file base;      // Must be first: SQLite sees this struct as a sqlite3_file.
+    ShimVfs* layer;
+    sqlite3_file* real;     // The parent VFS's file, allocated right after this struct.
+    const char* path;       // NULL for anonymous temp files.
+    int flags;
+    void* state;            // Per-file state owned by the layer.
+};
+
+class ShimVfs {
+public:
+    ShimVfs(std::string name, sqlite3_vfs* parent) : name_(std::move(name)), parent_(parent) {
+        std::memset(&vfs_, 0, sizeof(vfs_));
+        vfs_.iVersion = std::min(parent_->iVersion, 3);
+        vfs_.szOsFile = static_cast<int>(sizeof(ShimFile)) + parent_->szOsFile;
+        vfs_.mxPathname = parent_->mxPathname;
+        vfs_.zName = name_.c_str();
+        vfs_.pAppData = this;
+        vfs_.xOpen = xOpen;
+        vfs_.xDelete = xDelete;
+        vfs_.xAccess = xAccess;
+        vfs_.xFullPathname = xFullPathname;
+        vfs_.xDlOpen = xDlOpen;
+        vfs_.xDlError = xDlError;
+        vfs_.xDlSym = xDlSym;
+        vfs_.xDlClose = xDlClose;
+        vfs_.xRandomness = xRandomness;
+        vfs_.xSleep = xSleep;
+        vfs_.xCurrentTime = xCurrentTime;
+        vfs_.xGetLastError = xGetLastError;
+        vfs_.xCurrentTimeInt64 = xCurrentTimeInt64;
+        vfs_.xSetSystemCall = xSetSystemCall;
+        vfs_.xGetSystemCall = xGetSystemCall;
+        vfs_.xNextSystemCall = xNextSystemCall;
+
+        for (int v = 1; v <= 3; ++v) {
+            sqlite3_io_methods& m = methods_[v - 1];
+            std::memset(&m, 0, sizeof(m));
+            m.iVersion = v;
+            m.xClose = xClose;
+            m.xRead = xRead;
+            m.xWrite = xWrite;
+            m.xTruncate = xTruncate;
+            m.xSync = xSync;
+            m.xFileSize = xFileSize;
+            m.xLock = xLock;
+            m.xUnlock = xUnlock;
+            m.xCheckReservedLock = xCheckReservedLock;
+            m.xFileControl = xFileControl;
+            m.xSectorSize = xSectorSize;
+            m.xDeviceCharacteristics = xDeviceCharacteristics;
+            if (v >= 2) {
+                m.xShmMap = xShmMap;
+                m.xShmLock = xShmLock;
+                m.xShmBarrier = xShmBarrier;
+                m.xShmUnmap = xShmUnmap;
+            }
+            if (v >= 3) {
+                m.xFetch = xFetch;
+                m.xUnfetch = xUnfetch;
+            }
+        }
+    }
+
+    virtual ~ShimVfs() = default;
+
+    const std::string& name() const { return name_; }
+    sqlite3_vfs* vfs() { return &vfs_; }
+    sqlite3_vfs* parent() const { return parent_; }
+
+    // Counters printed after each benchmark, e.g. "reads=10 hits=4". Empty if none.
+    virtual std::string stats() const { return ""; }
+    virtual void resetStats() {}
+
+protected:
+    // Hooks invoked after the parent VFS has opened the file and before it is closed.
+    virtual int open(ShimFile*, const char*, int) { return SQLITE_OK; }
+    virtual void close(ShimFile*) {}
+
+    // File methods. The defaults forward to the parent VFS's file.
+    virtual int read(ShimFile* f, void* buf, int amt, sqlite3_int64 off) {
+        return f->real->pMethods->xRead(f->real, buf, amt, off);
+    }
+    virtual int write(ShimFile* f, const void* buf, int amt, sqlite3_int64 off) {
+        return f->real->pMethods->xWrite(f->real, buf, amt, off);
+    }
+    virtual int truncate(ShimFile* f, sqlite3_int64 size) {
+        return f->real->pMethods->xTruncate(f->real, size);
+    }
+    virtual int sync(ShimFile* f, int flags) {
+        return f->real->pMethods->xSync(f->real, flags);
+    }
+    virtual int fileSize(ShimFile* f, sqlite3_int64* size) {
+        return f->real->pMethods->xFileSize(f->real, size);
+    }
+    virtual int lock(ShimFile* f, int level) {
+        return f->real->pMethods->xLock(f->real, level);
+    }
+    virtual int unlock(ShimFile* f, int level) {
+        return f->real->pMethods->xUnlock(f->real, level);
+    }
+    virtual int checkReservedLock(ShimFile* f, int* out) {
+        return f->real->pMethods->xCheckReservedLock(f->real, out);
+    }
+    virtual int fileControl(ShimFile* f, int op, void* arg) {
+        return f->real->pMethods->xFileControl(f->real, op, arg);
+    }
+    virtual int sectorSize(ShimFile* f) {
+        return f->real->pMethods->xSectorSize(f->real);
+    }
+    virtual int deviceCharacteristics(ShimFile* f) {
+        return f->real->pMethods->xDeviceCharacteristics(f->real);
+    }
+    virtual int shmMap(ShimFile* f, int region, int size, int extend, void volatile** out) {
+        return f->real->pMethods->xShmMap(f->real, region, size, extend, out);
+    }
+    virtual int shmLock(ShimFile* f, int offset, int n, int flags) {
+        return f->real->pMethods->xShmLock(f->real, offset, n, flags);
+    }
+    virtual void shmBarrier(ShimFile* f) {
+        f->real->pMethods->xShmBarrier(f->real);
+    }
+    virtual int shmUnmap(ShimFile* f, int delete_flag) {
+        return f->real->pMethods->xShmUnmap(f->real, delete_flag);
+    }
+    virtual int fetch(ShimFile* f, sqlite3_int64 off, int amt, void** out) {
+        return f->real->pMethods->xFetch(f->real, off, amt, out);
+    }
+    virtual int unfetch(ShimFile* f, sqlite3_int64 off, void* p) {
+        return f->real->pMethods->xUnfetch(f->real, off, p);
+    }
+
+    static bool isMainDb(const ShimFile* f) { return (f->flags & SQLITE_OPEN_MAIN_DB) != 0; }
+    // The database itself plus its WAL and journals, as opposed to temp files.
+    static bool isPersistent(const ShimFile* f) {
+        return (f->flags & (SQLITE_OPEN_MAIN_DB | SQLITE_OPEN_MAIN_JOURNAL | SQLITE_OPEN_WAL | SQLITE_OPEN_SUPER_JOURNAL)) != 0;
+    }
+
+private:
+    std::string name_;
+    sqlite3_vfs* parent_;
+    sqlite3_vfs vfs_;
+    sqlite3_io_methods methods_[3];
+
+    static ShimVfs* self(sqlite3_vfs* vfs) { return static_cast<ShimVfs*>(vfs->pAppData); }
+    static ShimFile* shim(sqlite3_file* file) { return reinterpret_cast<ShimFile*>(file); }
+    static ShimVfs* layerOf(sqlite3_file* file) { return shim(file)->layer; }
+
+    static int xOpen(sqlite3_vfs* vfs, const char* name, sqlite3_file* file, int flags, int* out_flags) {
+        ShimVfs* layer = self(vfs);
+        ShimFile* f = shim(file);
+        f->base.pMethods = nullptr;
+        f->layer = layer;
+        f->real = reinterpret_cast<sqlite3_file*>(f + 1);
+        f->path = name;
+        f->flags = flags;
+        f->state = nullptr;
+        int rc = layer->parent_->xOpen(layer->parent_, name, f->real, flags, out_flags);
+        if (f->real->pMethods == nullptr) {
+            return rc;
+        }
+        f->base.pMethods = &layer->methods_[std::min(f->real->pMethods->iVersion, 3) - 1];
+        if (rc == SQLITE_OK) {
+            rc = layer->open(f, name, flags);
+        }
+        return rc;
+    }
+    static int xDelete(sqlite3_vfs* vfs, const char* name, int sync_dir) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xDelete(p, name, sync_dir);
+    }
+    static int xAccess(sqlite3_vfs* vfs, const char* name, int flags, int* out) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xAccess(p, name, flags, out);
+    }
+    static int xFullPathname(sqlite3_vfs* vfs, const char* name, int n, char* out) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xFullPathname(p, name, n, out);
+    }
+    static void* xDlOpen(sqlite3_vfs* vfs, const char* name) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xDlOpen(p, name);
+    }
+    static void xDlError(sqlite3_vfs* vfs, int n, char* msg) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        p->xDlError(p, n, msg);
+    }
+    static void (*xDlSym(sqlite3_vfs* vfs, void* handle, const char* sym))(void) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xDlSym(p, handle, sym);
+    }
+    static void xDlClose(sqlite3_vfs* vfs, void* handle) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        p->xDlClose(p, handle);
+    }
+    static int xRandomness(sqlite3_vfs* vfs, int n, char* out) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xRandomness(p, n, out);
+    }
+    static int xSleep(sqlite3_vfs* vfs, int micros) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xSleep(p, micros);
+    }
+    static int xCurrentTime(sqlite3_vfs* vfs, double* out) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xCurrentTime(p, out);
+    }
+    static int xGetLastError(sqlite3_vfs* vfs, int n, char* out) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xGetLastError ? p->xGetLastError(p, n, out) : 0;
+    }
+    static int xCurrentTimeInt64(sqlite3_vfs* vfs, sqlite3_int64* out) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xCurrentTimeInt64(p, out);
+    }
+    static int xSetSystemCall(sqlite3_vfs* vfs, const char* name, sqlite3_syscall_ptr fn) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xSetSystemCall(p, name, fn);
+    }
+    static sqlite3_syscall_ptr xGetSystemCall(sqlite3_vfs* vfs, const char* name) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xGetSystemCall(p, name);
+    }
+    static const char* xNextSystemCall(sqlite3_vfs* vfs, const char* name) {
+        sqlite3_vfs* p = self(vfs)->parent_;
+        return p->xNextSystemCall(p, name);
+    }
+
+    static int xClose(sqlite3_file* file) {
+        ShimFile* f = shim(file);
+        f->layer->close(f);
+        return f->real->pMethods->xClose(f->real);
+    }
+    static int xRead(sqlite3_file* file, void* buf, int amt, sqlite3_int64 off) {
+        return layerOf(file)->read(shim(file), buf, amt, off);
+    }
+    static int xWrite(sqlite3_file* file, const void* buf, int amt, sqlite3_int64 off) {
+        return layerOf(file)->write(shim(file), buf, amt, off);
+    }
+    static int xTruncate(sqlite3_file* file, sqlite3_int64 size) {
+        return layerOf(file)->truncate(shim(file), size);
+    }
+    static int xSync(sqlite3_file* file, int flags) {
+        return layerOf(file)->sync(shim(file), flags);
+    }
+    static int xFileSize(sqlite3_file* file, sqlite3_int64* size) {
+        return layerOf(file)->fileSize(shim(file), size);
+    }
+    static int xLock(sqlite3_file* file, int level) {
+        return layerOf(file)->lock(shim(file), level);
+    }
+    static int xUnlock(sqlite3_file* file, int level) {
+        return layerOf(file)->unlock(shim(file), level);
+    }
+    static int xCheckReservedLock(sqlite3_file* file, int* out) {
+        return layerOf(file)->checkReservedLock(shim(file), out);
+    }
+    static int xFileControl(sqlite3_file* file, int op, void* arg) {
+        return layerOf(file)->fileControl(shim(file), op, arg);
+    }
+    static int xSectorSize(sqlite3_file* file) {
+        return layerOf(file)->sectorSize(shim(file));
+    }
+    static int xDeviceCharacteristics(sqlite3_file* file) {
+        return layerOf(file)->deviceCharacteristics(shim(file));
+    }
+    static int xShmMap(sqlite3_file* file, int region, int size, int extend, void volatile** out) {
+        return layerOf(file)->shmMap(shim(file), region, size, extend, out);
+    }
+    static int xShmLock(sqlite3_file* file, int offset, int n, int flags) {
+        return layerOf(file)->shmLock(shim(file), offset, n, flags);
+    }
+    static void xShmBarrier(sqlite3_file* file) {
+        layerOf(file)->shmBarrier(shim(file));
+    }
+    static int xShmUnmap(sqlite3_file* file, int delete_flag) {
+        return layerOf(file)->shmUnmap(shim(file), delete_flag);
+    }
+    static int xFetch(sqlite3_file* file, sqlite3_int64 off, int amt, void** out) {
+        return layerOf(file)->fetch(shim(file), off, amt, out);
+    }
+    static int xUnfetch(sqlite3_file* file, sqlite3_int64 off, void* p) {
+        return layerOf(file)->unfetch(shim(file), off, p);
+    }
+};
+
+// Layers registered by SetupVfsStack(), innermost first. They live until exit.
+std::vector<std::unique_ptr<ShimVfs>>& VfsLayers() {
+    static std::vector<std::unique_ptr<ShimVfs>> layers;
+    return layers;
+}
+
+void PrintVfsStats() {
+    for (auto it = VfsLayers().rbegin(); it != VfsLayers().rend(); ++it) {
+        std::string s = (*it)->stats();
+        if (!s.empty()) {
+            std::cout << "  [" << (*it)->name() << "] " << s << std::endl;
+        }
+    }
+}
+
+void ResetVfsStats() {
+    for (auto& layer : VfsLayers()) {
+        layer->resetStats();
+    }
+}
+
+// Fsyncs the directory containing |path| so a newly created file survives a crash.
+int SyncDirectoryOf(const char* path) {
+    std::string dir(path);
+    size_t slash = dir.find_last_of('/');
+    dir = (slash == std::string::npos) ? "." : (slash == 0 ? "/" : dir.substr(0, slash));
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return SQLITE_OK;  // Same as the unix VFS: a missing directory fd is not fatal.
+    }
+    int rc = fsync(fd) == 0 ? SQLITE_OK : SQLITE_IOERR_DIR_FSYNC;
+    ::close(fd);
+    return rc;
+}
+
+#ifdef HAVE_IO_URING
+
+// --- io_uring VFS ---
+//
+// A minimal io_uring wrapper on top of the raw syscalls so the tool does not
+// need liburing. Only one thread touches the ring at a time (callers hold a
+// mutex), so plain acquire/release ordering on the shared indices is enough.
+
+class IoUring {
+public:
+    ~IoUring() {
+        if (sqes_) munmap(sqes_, sqes_size_);
+        if (cq_ptr_ && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_size_);
+        if (sq_ptr_) munmap(sq_ptr_, sq_size_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+        if (fd_ < 0) {
+            return false;
+        }
+        sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        }
+        sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) {
+            sq_ptr_ = nullptr;
+            return false;
+        }
+        cq_ptr_ = single_mmap ? sq_ptr_
+                              : mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cq_ptr_ == MAP_FAILED) {
+            cq_ptr_ = nullptr;
+            return false;
+        }
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        unsigned* sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        for (unsigned i = 0; i < p.sq_entries; ++i) {
+            sq_array[i] = i;  // SQE slot i is always published at ring index i.
+        }
+        char* cq = static_cast<char*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        entries_ = p.sq_entries;
+        local_tail_ = *sq_tail_;
+        return true;
+    }
+
+    unsigned entries() const { return entries_; }
+    unsigned unsubmitted() const { return local_tail_ - *sq_tail_; }
+
+    // Returns a zeroed SQE, or nullptr if the submission queue is full.
+    io_uring_sqe* getSqe() {
+        unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (local_tail_ - head >= entries_) {
+            return nullptr;
+        }
+        io_uring_sqe* sqe = &sqes_[local_tail_ & sq_mask_];
+        std::memset(sqe, 0, sizeof(*sqe));
+        ++local_tail_;
+        return sqe;
+    }
+
+    // Publishes all prepared SQEs and optionally waits for |wait_nr| completions.
+    int submit(unsigned wait_nr) {
+        unsigned to_submit = unsubmitted();
+        __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+        if (to_submit == 0 && wait_nr == 0) {
+            return 0;
+        }
+        ++enters_;
+        int ret;
+        do {
+            ret = static_cast<int>(syscall(__NR_io_uring_enter, fd_, to_submit, wait_nr,
+                                           wait_nr ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+        } while (ret < 0 && errno == EINTR);
+        return ret;
+    }
+
+    // Calls fn(user_data, res) for every available completion.
+    template <typename Fn>
+    void reap(Fn fn) {
+        unsigned head = *cq_head_;
+        while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            fn(cqe.user_data, cqe.res);
+            ++head;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+    uint64_t enters() const { return enters_; }
+    void resetEnters() { enters_ = 0; }
+
+private:
+    int fd_ = -1;
+    void* sq_ptr_ = nullptr;
+    void* cq_ptr_ = nullptr;
+    size_t sq_size_ = 0, cq_size_ = 0, sqes_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned sq_mask_ = 0, cq_mask_ = 0, entries_ = 0;
+    unsigned local_tail_ = 0;
+    uint64_t enters_ = 0;
+};
+
+// Services xRead/xWrite/xSync through a single io_uring shared by all files.
+// Locking, shared memory and file creation are left to the parent VFS; this
+// layer reopens each named file to get its own descriptor for the ring.
+//
+//  - Main-database reads that form a sequential run trigger asynchronous
+//    read-ahead of the next --uring_readahead pages.
+//  - WAL and rollback-journal writes are queued in the ring without waiting
+//    and submitted together with the fsync when SQLite calls xSync. Queued
+//    writes are also flushed before any read, lock change or shm barrier, so
+//    other connections never observe a stale file.
+//
+// Because each file has a second descriptor, do not let other processes use
+// the database while it is open through this VFS: closing that descriptor
+// drops the process's POSIX locks on the file.
+class IoUringVfs : public ShimVfs {
+public:
+    IoUringVfs(sqlite3_vfs* parent, unsigned depth, int readahead_pages)
+        : ShimVfs("io_uring", parent), readahead_pages_(std::max(readahead_pages, 0)) {
+        ok_ = ring_.init(std::max(depth, 4u));
+    }
+
+    bool ok() const { return ok_; }
+
+    std::string stats() const override {
+        std::ostringstream out;
+        out << "reads=" << reads_ << " readahead_issued=" << ra_issued_ << " readahead_hits=" << ra_hits_
+            << " writes=" << writes_ << " batched_writes=" << batched_writes_ << " syncs=" << syncs_
+            << " enters=" << ring_.enters();
+        return out.str();
+    }
+
+    void resetStats() override {
+        std::lock_guard<std::mutex> guard(mu_);
+        reads_ = ra_issued_ = ra_hits_ = writes_ = batched_writes_ = syncs_ = 0;
+        ring_.resetEnters();
+    }
+
+protected:
+    int open(ShimFile* f, const char* name, int flags) override {
+        if (name == nullptr) {
+            return SQLITE_OK;  // Anonymous temp files are left to the parent VFS.
+        }
+        int fd = ::open(name, (flags & SQLITE_OPEN_READONLY) ? O_RDONLY : O_RDWR);
+        if (fd < 0) {
+            return SQLITE_OK;  // e.g. delete-on-close files the parent already unlinked.
+        }
+        auto* fs = new FileState;
+        fs->fd = fd;
+        fs->batch_writes = (flags & (SQLITE_OPEN_WAL | SQLITE_OPEN_MAIN_JOURNAL)) != 0;
+        fs->readahead = isMainDb(f) && readahead_pages_ > 0;
+        fs->dirsync = fs->batch_writes && (flags & SQLITE_OPEN_CREATE);
+        fs->slots.resize(fs->readahead ? readahead_pages_ : 0);
+        f->state = fs;
+        return SQLITE_OK;
+    }
+
+    void close(ShimFile* f) override {
+        FileState* fs = state(f);
+        if (!fs) return;
+        std::lock_guard<std::mutex> guard(mu_);
+        flushWrites();
+        for (auto& slot : fs->slots) {
+            if (slot.busy) waitFor(&slot.op);
+        }
+        ::close(fs->fd);
+        delete fs;
+        f->state = nullptr;
+    }
+
+    int read(ShimFile* f, void* buf, int amt, sqlite3_int64 off) override {
+        FileState* fs = state(f);
+        if (!fs) return ShimVfs::read(f, buf, amt, off);
+        std::lock_guard<std::mutex> guard(mu_);
+        ++reads_;
+        int rc = flushWrites();
+        if (rc != SQLITE_OK) return rc;
+
+        if (fs->readahead) {
+            if (off == fs->next_off) {
+                ++fs->run;
+            } else {
+                fs->run = 0;
+                fs->ra_end = -1;
+            }
+            fs->next_off = off + amt;
+            if (consumeSlot(fs, buf, amt, off)) {
+                ++ra_hits_;
+                issueReadahead(fs, amt);
+                return SQLITE_OK;
+            }
+        }
+
+        rc = transfer(fs->fd, false, buf, amt, off);
+        if (fs->readahead) issueReadahead(fs, amt);
+        return rc;
+    }
+
+    int write(ShimFile* f, const void* buf, int amt, sqlite3_int64 off) override {
+        FileState* fs = state(f);
+        if (!fs) return ShimVfs::write(f, buf, amt, off);
+        std::lock_guard<std::mutex> guard(mu_);
+        ++writes_;
+        invalidateSlots(fs, off, amt);
+        if (!fs->batch_writes) {
+            int rc = flushWrites();
+            return rc != SQLITE_OK ? rc : transfer(fs->fd, true, const_cast<void*>(buf), amt, off);
+        }
+        for (const auto& pw : pending_) {
+            if (pw->fd == fs->fd && pw->off < off + amt && off < pw->off + static_cast<sqlite3_int64>(pw->data.size())) {
+                int rc = flushWrites();  // io_uring does not order overlapping writes.
+                if (rc != SQLITE_OK) return rc;
+                break;
+            }
+        }
+        auto pw = std::make_unique<PendingWrite>();
+        pw->fd = fs->fd;
+        pw->off = off;
+        pw->data.assign(static_cast<const char*>(buf), static_cast<const char*>(buf) + amt);
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = pw->fd;
+        sqe->addr = reinterpret_cast<uint64_t>(pw->data.data());
+        sqe->len = static_cast<unsigned>(amt);
+        sqe->off = static_cast<uint64_t>(off);
+        sqe->user_data = reinterpret_cast<uint64_t>(&pw->op);
+        pending_.push_back(std::move(pw));
+        ++batched_writes_;
+        return SQLITE_OK;
+    }
+
+    int truncate(ShimFile* f, sqlite3_int64 size) override {
+        FileState* fs = state(f);
+        if (fs) {
+            std::lock_guard<std::mutex> guard(mu_);
+            int rc = flushWrites();
+            if (rc != SQLITE_OK) return rc;
+            invalidateSlots(fs, 0, -1);
+        }
+        return ShimVfs::truncate(f, size);
+    }
+
+    int sync(ShimFile* f, int flags) override {
+        FileState* fs = state(f);
+        if (!fs) return ShimVfs::sync(f, flags);
+        std::lock_guard<std::mutex> guard(mu_);
+        ++syncs_;
+        // Queued writes and the fsync go to the kernel in one io_uring_enter();
+        // IOSQE_IO_DRAIN holds the fsync back until every earlier write is done.
+        Op fsync_op;
+        io_uring_sqe* sqe = nextSqe();
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = fs->fd;
+        sqe->flags = IOSQE_IO_DRAIN;
+        sqe->fsync_flags = (flags & SQLITE_SYNC_DATAONLY) ? IORING_FSYNC_DATASYNC : 0;
+        sqe->user_data = reinterpret_cast<uint64_t>(&fsync_op);
+        int rc = flushWrites();
+        waitFor(&fsync_op);
+        if (rc != SQLITE_OK) return rc;
+        if (fsync_op.res < 0) return SQLITE_IOERR_FSYNC;
+        if (fs->dirsync) {
+            fs->dirsync = false;
+            return SyncDirectoryOf(f->path);
+        }
+        return SQLITE_OK;
+    }
+
+    int fileSize(ShimFile* f, sqlite3_int64* size) override {
+        if (state(f)) {
+            std::lock_guard<std::mutex> guard(mu_);
+            int rc = flushWrites();
+            if (rc != SQLITE_OK) return rc;
+        }
+        return ShimVfs::fileSize(f, size);
+    }
+
+    // Lock transitions bound a transaction: publish queued writes and forget
+    // read-ahead data another connection may since have overwritten.
+    int lock(ShimFile* f, int level) override {
+        int rc = publish(f);
+        return rc != SQLITE_OK ? rc : ShimVfs::lock(f, level);
+    }
+    int unlock(ShimFile* f, int level) override {
+        int rc = publish(f);
+        return rc != SQLITE_OK ? rc : ShimVfs::unlock(f, level);
+    }
+    int shmLock(ShimFile* f, int offset, int n, int flags) override {
+        int rc = publish(f);
+        return rc != SQLITE_OK ? rc : ShimVfs::shmLock(f, offset, n, flags);
+    }
+    void shmBarrier(ShimFile* f) override {
+        publish(f);
+        ShimVfs::shmBarrier(f);
+    }
+
+private:
+    struct Op {
+        int32_t res = 0;
+        bool done = false;
+    };
+    struct PendingWrite {
+        Op op;
+        int fd = -1;
+        sqlite3_int64 off = 0;
+        std::vector<char> data;
+    };
+    struct Slot {
+        Op op;
+        sqlite3_int64 off = -1;
+        int len = 0;
+        bool busy = false;    // Holds an issued read (in flight or completed).
+        bool usable = false;  // Data may be returned to SQLite.
+        std::vector<char> buf;
+    };
+    struct FileState {
+        int fd = -1;
+        bool batch_writes = false;
+        bool readahead = false;
+        bool dirsync = false;
+        sqlite3_int64 next_off = -1;
+        sqlite3_int64 ra_end = -1;
+        int run = 0;
+        std::vector<Slot> slots;
+    };
+
+    static FileState* state(ShimFile* f) { return static_cast<FileState*>(f->state); }
+
+    int publish(ShimFile* f) {
+        FileState* fs = state(f);
+        std::lock_guard<std::mutex> guard(mu_);
+        if (fs) invalidateSlots(fs, 0, -1);
+        return flushWrites();
+    }
+
+    void reapCompletions() {
+        ring_.reap([this](uint64_t user_data, int32_t res) {
+            Op* op = reinterpret_cast<Op*>(user_data);
+            op->res = res;
+            op->done = true;
+            --inflight_;
+        });
+    }
+
+    void waitFor(Op* op) {
+        while (!op->done) {
+            ring_.submit(1);
+            reapCompletions();
+        }
+    }
+
+    // Returns a free SQE, waiting for completions if the ring is saturated.
+    io_uring_sqe* nextSqe() {
+        while (inflight_ >= ring_.entries()) {
+            ring_.submit(1);
+            reapCompletions();
+        }
+        io_uring_sqe* sqe = ring_.getSqe();
+        if (!sqe) {
+            ring_.submit(0);
+            sqe = ring_.getSqe();
+        }
+        ++inflight_;
+        return sqe;
+    }
+
+    // Synchronous read or write through the ring, retrying partial transfers.
+    int transfer(int fd, bool is_write, void* buf, int amt, sqlite3_int64 off) {
+        char* p = static_cast<char*>(buf);
+        int done = 0;
+        while (done < amt) {
+            Op op;
+            io_uring_sqe* sqe = nextSqe();
+            sqe->opcode = is_write ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe->fd = fd;
+            sqe->addr = reinterpret_cast<uint64_t>(p + done);
+            sqe->len = static_cast<unsigned>(amt - done);
+            sqe->off = static_cast<uint64_t>(off + done);
+            sqe->user_data = reinterpret_cast<uint64_t>(&op);
+            waitFor(&op);
+            if (op.res < 0) {
+                if (is_write) return op.res == -ENOSPC ? SQLITE_FULL : SQLITE_IOERR_WRITE;
+                return SQLITE_IOERR_READ;
+            }
+            if (op.res == 0) {
+                if (is_write) return SQLITE_IOERR_WRITE;
+                std::memset(p + done, 0, amt - done);
+                return SQLITE_IOERR_SHORT_READ;
+            }
+            done += op.res;
+        }
+        return SQLITE_OK;
+    }
+
+    int flushWrites() {
+        if (pending_.empty()) return SQLITE_OK;
+        int rc = SQLITE_OK;
+        for (auto& pw : pending_) {
+            waitFor(&pw->op);
+            if (pw->op.res != static_cast<int32_t>(pw->data.size()) && rc == SQLITE_OK) {
+                rc = pw->op.res == -ENOSPC ? SQLITE_FULL : SQLITE_IOERR_WRITE;
+            }
+        }
+        pending_.clear();
+        return rc;
+    }
+
+    bool consumeSlot(FileState* fs, void* buf, int amt, sqlite3_int64 off) {
+        for (auto& slot : fs->slots) {
+            if (!slot.busy || !slot.usable || off < slot.off || off + amt > slot.off + slot.len) continue;
+            waitFor(&slot.op);
+            slot.busy = false;
+            if (slot.op.res < static_cast<int32_t>(off - slot.off + amt)) return false;
+            std::memcpy(buf, slot.buf.data() + (off - slot.off), amt);
+            return true;
+        }
+        return false;
+    }
+
+    void issueReadahead(FileState* fs, int amt) {
+        if (fs->run < 2) return;
+        sqlite3_int64 next = std::max(fs->next_off, fs->ra_end);
+        sqlite3_int64 limit = fs->next_off + static_cast<sqlite3_int64>(readahead_pages_) * amt;
+        for (; next < limit; next += amt) {
+            Slot* slot = freeSlot(fs);
+            if (!slot) break;
+            slot->buf.resize(amt);
+            slot->off = next;
+            slot->len = amt;
+            slot->busy = true;
+            slot->usable = true;
+            slot->op = Op();
+            io_uring_sqe* sqe = nextSqe();
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = fs->fd;
+            sqe->addr = reinterpret_cast<uint64_t>(slot->buf.data());
+            sqe->len = static_cast<unsigned>(amt);
+            sqe->off = static_cast<uint64_t>(next);
+            sqe->user_data = reinterpret_cast<uint64_t>(&slot->op);
+            ++ra_issued_;
+        }
+        fs->ra_end = next;
+        ring_.submit(0);
+    }
+
+    Slot* freeSlot(FileState* fs) {
+        for (auto& slot : fs->slots) {
+            if (!slot.busy) return &slot;
+            bool passed = slot.off + slot.len <= fs->next_off - slot.len;
+            if (slot.op.done && (!slot.usable || passed)) return &slot;
+        }
+        return nullptr;
+    }
+
+    // Drops read-ahead data overlapping [off, off + amt); amt < 0 means everything.
+    void invalidateSlots(FileState* fs, sqlite3_int64 off, int amt) {
+        for (auto& slot : fs->slots) {
+            if (slot.busy && (amt < 0 || (slot.off < off + amt && off < slot.off + slot.len))) {
+                slot.usable = false;
+            }
+        }
+        if (amt < 0) {
+            fs->ra_end = -1;
+            fs->run = 0;
+        }
+    }
+
+    std::mutex mu_;
+    IoUring ring_;
+    bool ok_ = false;
+    int readahead_pages_;
+    unsigned inflight_ = 0;
+    std::vector<std::unique_ptr<PendingWrite>> pending_;
+    std::atomic<uint64_t> reads_{0}, ra_issued_{0}, ra_hits_{0};
+    std::atomic<uint64_t> writes_{0}, batched_writes_{0}, syncs_{0};
+};
+
+#endif  // HAVE_IO_URING
+
+// --- O_DIRECT VFS ---
+//
+// Reopens the main database with O_DIRECT so its pages live only in SQLite's
+// page cache, never in the kernel's. Requests that are not aligned to
+// --odirect_align (SQLite's buffers rarely are) go through an aligned bounce
+// buffer; sub-block writes are done as read-modify-write. WAL, journals and
+// the wal-index keep using buffered I/O through the parent VFS, and xFetch
+// never returns a mapping, so mmap_size has no effect on the main database.
+// Filesystems without O_DIRECT support (e.g. tmpfs) fall back to buffered I/O.
+//
+// As with the io_uring layer, the O_DIRECT descriptor is a second one on the
+// database file, so do not let other processes use the database while it is
+// open through this VFS: closing it drops the process's POSIX locks.
+class ODirectVfs : public ShimVfs {
+public:
+    ODirectVfs(sqlite3_vfs* parent, size_t align) : ShimVfs("odirect", parent), align_(std::max<size_t>(align, 512)) {}
+
+    std::string stats() const override {
+        std::ostringstream out;
+        out << "direct_reads=" << direct_reads_ << " direct_writes=" << direct_writes_
+            << " bounced=" << bounced_ << " rmw_writes=" << rmw_writes_ << " buffered_files=" << buffered_files_;
+        return out.str();
+    }
+
+    void resetStats() override {
+        direct_reads_ = direct_writes_ = bounced_ = rmw_writes_ = 0;
+    }
+
+protected:
+    int open(ShimFile* f, const char* name, int flags) override {
+        if (!isMainDb(f) || name == nullptr) {
+            return SQLITE_OK;
+        }
+        int fd = ::open(name, ((flags & SQLITE_OPEN_READONLY) ? O_RDONLY : O_RDWR) | O_DIRECT);
+        if (fd < 0) {
+            if (buffered_files_++ == 0) {
+                std::cerr << "odirect: O_DIRECT unsupported for " << name << " (" << strerror(errno)
+                          << "), using buffered I/O" << std::endl;
+            }
+            return SQLITE_OK;
+        }
+        auto* fs = new FileState;
+        fs->fd = fd;
+        f->state = fs;
+        return SQLITE_OK;
+    }
+
+    void close(ShimFile* f) override {
+        FileState* fs = state(f);
+        if (!fs) return;
+        ::close(fs->fd);
+        free(fs->bounce);
+        delete fs;
+        f->state = nullptr;
+    }
+
+    int read(ShimFile* f, void* buf, int amt, sqlite3_int64 off) override {
+        FileState* fs = state(f);
+        if (!fs) return ShimVfs::read(f, buf, amt, off);
+        ++direct_reads_;
+        if (aligned(buf, amt, off)) {
+            ssize_t got = preadFull(fs->fd, buf, amt, off);
+            if (got < 0) return SQLITE_IOERR_READ;
+            if (got < amt) {
+                std::memset(static_cast<char*>(buf) + got, 0, amt - got);
+                return SQLITE_IOERR_SHORT_READ;
+            }
+            return SQLITE_OK;
+        }
+        ++bounced_;
+        sqlite3_int64 start = alignDown(off);
+        size_t len = static_cast<size_t>(alignUp(off + amt) - start);
+        char* bounce = bounceBuffer(fs, len);
+        if (!bounce) return SQLITE_IOERR_NOMEM;
+        ssize_t got = preadFull(fs->fd, bounce, len, start);
+        if (got < 0) return SQLITE_IOERR_READ;
+        sqlite3_int64 avail = std::max<sqlite3_int64>(0, start + got - off);
+        sqlite3_int64 n = std::min<sqlite3_int64>(avail, amt);
+        std::memcpy(buf, bounce + (off - start), static_cast<size_t>(n));
+        if (n < amt) {
+            std::memset(static_cast<char*>(buf) + n, 0, static_cast<size_t>(amt - n));
+            return SQLITE_IOERR_SHORT_READ;
+        }
+        return SQLITE_OK;
+    }
+
+    int write(ShimFile* f, const void* buf, int amt, sqlite3_int64 off) override {
+        FileState* fs = state(f);
+        if (!fs) return ShimVfs::write(f, buf, amt, off);
+        ++direct_writes_;
+        if (aligned(buf, amt, off)) {
+            return pwriteFull(fs->fd, buf, amt, off);
+        }
+        ++bounced_;
+        sqlite3_int64 start = alignDown(off);
+        sqlite3_int64 end = alignUp(off + amt);
+        size_t len = static_cast<size_t>(end - start);
+        char* bounce = bounceBuffer(fs, len);
+        if (!bounce) return SQLITE_IOERR_NOMEM;
+        struct stat st;
+        if (fstat(fs->fd, &st) != 0) return SQLITE_IOERR_FSTAT;
+        if (start != off || end != off + amt) {
+            // Preserve the neighbouring bytes that share a block with this write.
+            ++rmw_writes_;
+            ssize_t got = preadFull(fs->fd, bounce, len, start);
+            if (got < 0) return SQLITE_IOERR_READ;
+            std::memset(bounce + got, 0, len - got);
+        }
+        std::memcpy(bounce + (off - start), buf, amt);
+        int rc = pwriteFull(fs->fd, bounce, len, start);
+        if (rc == SQLITE_OK && end > st.st_size && end > off + amt) {
+            // The block-sized write grew the file past what SQLite asked for.
+            if (ftruncate(fs->fd, std::max<sqlite3_int64>(st.st_size, off + amt)) != 0) {
+                return SQLITE_IOERR_TRUNCATE;
+            }
+        }
+        return rc;
+    }
+
+    int sectorSize(ShimFile* f) override {
+        int parent = ShimVfs::sectorSize(f);
+        return state(f) ? std::max(parent, static_cast<int>(align_)) : parent;
+    }
+
+    int fetch(ShimFile* f, sqlite3_int64 off, int amt, void** out) override {
+        if (state(f)) {
+            *out = nullptr;  // A buffered mapping would reintroduce the double caching.
+            return SQLITE_OK;
+        }
+        return ShimVfs::fetch(f, off, amt, out);
+    }
+
+private:
+    struct FileState {
+        int fd = -1;
+        char* bounce = nullptr;
+        size_t bounce_size = 0;
+    };
+
+    static FileState* state(ShimFile* f) { return static_cast<FileState*>(f->state); }
+
+    bool aligned(const void* buf, int amt, sqlite3_int64 off) const {
+        return reinterpret_cast<uintptr_t>(buf) % align_ == 0 && amt % align_ == 0 && off % align_ == 0;
+    }
+    sqlite3_int64 alignDown(sqlite3_int64 v) const { return v - v % static_cast<sqlite3_int64>(align_); }
+    sqlite3_int64 alignUp(sqlite3_int64 v) const { return alignDown(v + align_ - 1); }
+
+    char* bounceBuffer(FileState* fs, size_t len) {
+        if (fs->bounce_size < len) {
+            free(fs->bounce);
+            fs->bounce = nullptr;
+            fs->bounce_size = 0;
+            void* p = nullptr;
+            if (posix_memalign(&p, align_, len) != 0) return nullptr;
+            fs->bounce = static_cast<char*>(p);
+            fs->bounce_size = len;
+        }
+        return fs->bounce;
+    }
+
+    static ssize_t preadFull(int fd, void* buf, size_t len, sqlite3_int64 off) {
+        size_t done = 0;
+        while (done < len) {
+            ssize_t n = pread(fd, static_cast<char*>(buf) + done, len - done, off + done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) return -1;
+            if (n == 0) break;
+            done += n;
+        }
+        return static_cast<ssize_t>(done);
+    }
+
+    static int pwriteFull(int fd, const void* buf, size_t len, sqlite3_int64 off) {
+        size_t done = 0;
+        while (done < len) {
+            ssize_t n = pwrite(fd, static_cast<const char*>(buf) + done, len - done, off + done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) return errno == ENOSPC ? SQLITE_FULL : SQLITE_IOERR_WRITE;
+            done += n;
+        }
+        return SQLITE_OK;
+    }
+
+    size_t align_;
+    std::atomic<uint64_t> direct_reads_{0}, direct_writes_{0}, bounced_{0}, rmw_writes_{0};
+    std::atomic<uint64_t> buffered_files_{0};
+};
+
+// --- Latency-Injecting VFS ---
+//
+// Delays reads, writes and syncs on the database, WAL and journal files to
+// emulate slower or network-attached storage. Each operation waits for a base
+// latency drawn from --latency_dist, plus uniform jitter, plus the time the
+// transfer occupies a shared link of --latency_bandwidth_mbps. The random
+// stream is seeded, so a given run injects the same delay sequence every time.
+
+// Sleeps for |ns|, spinning for the last stretch because the scheduler cannot
+// wake a thread with microsecond accuracy.
+void PreciseSleep(std::chrono::nanoseconds ns) {
+    auto deadline = std::chrono::steady_clock::now() + ns;
+    if (ns > std::chrono::microseconds(200)) {
+        std::this_thread::sleep_for(ns - std::chrono::microseconds(100));
+    }
+    while (std::chrono::steady_clock::now() < deadline) {
+    }
+}
+
+class LatencyVfs : public ShimVfs {
+public:
+    struct Config {
+        double read_us = 0;
+        double write_us = 0;
+        double sync_us = 0;
+        std::string dist = "fixed";
+        double sigma = 0.5;
+        double jitter_us = 0;
+        double bandwidth_mbps = 0;
+        uint64_t seed = 1;
+    };
+
+    LatencyVfs(sqlite3_vfs* parent, Config cfg) : ShimVfs("latency", parent), cfg_(std::move(cfg)), rng_(cfg_.seed) {
+        if (cfg_.dist != "fixed" && cfg_.dist != "uniform" && cfg_.dist != "exponential" && cfg_.dist != "lognormal") {
+            std::cerr << "Unknown latency distribution: " << cfg_.dist << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    std::string stats() const override {
+        uint64_t ops = delayed_ops_;
+        std::ostringstream out;
+        out << "delayed_ops=" << ops << " injected_ms=" << std::fixed << std::setprecision(1) << injected_ns_ / 1e6
+            << " avg_injected_us=" << (ops ? injected_ns_ / 1e3 / ops : 0.0);
+        return out.str();
+    }
+
+    void resetStats() override {
+        delayed_ops_ = 0;
+        injected_ns_ = 0;
+    }
+
+protected:
+    int read(ShimFile* f, void* buf, int amt, sqlite3_int64 off) override {
+        delay(f, cfg_.read_us, amt);
+        return ShimVfs::read(f, buf, amt, off);
+    }
+
+    int write(ShimFile* f, const void* buf, int amt, sqlite3_int64 off) override {
+        delay(f, cfg_.write_us, amt);
+        return ShimVfs::write(f, buf, amt, off);
+    }
+
+    int sync(ShimFile* f, int flags) override {
+        delay(f, cfg_.sync_us, 0);
+        return ShimVfs::sync(f, flags);
+    }
+
+private:
+    void delay(ShimFile* f, double base_us, int bytes) {
+        if (!isPersistent(f)) return;
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point until;
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            double us = sampleUs(base_us);
+            until = now + std::chrono::nanoseconds(static_cast<int64_t>(us * 1000));
+            if (cfg_.bandwidth_mbps > 0 && bytes > 0) {
+                // Transfers queue behind each other on the emulated link.
+                auto start = std::max(until, link_free_);
+                link_free_ = start + std::chrono::nanoseconds(static_cast<int64_t>(bytes / cfg_.bandwidth_mbps * 1000));
+                until = link_free_;
+            }
+        }
+        if (until <= now) return;
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(until - now);
+        ++delayed_ops_;
+        injected_ns_ += ns.count();
+        PreciseSleep(ns);
+    }
+
+    double sampleUs(double mean_us) {
+        double us = mean_us;
+        if (mean_us > 0) {
+            if (cfg_.dist == "uniform") {
+                us = std::uniform_real_distribution<double>(0, 2 * mean_us)(rng_);
+            } else if (cfg_.dist == "exponential") {
+                us = std::exponential_distribution<double>(1.0 / mean_us)(rng_);
+            } else if (cfg_.dist == "lognormal") {
+                double mu = std::log(mean_us) - cfg_.sigma * cfg_.sigma / 2;
+                us = std::lognormal_distribution<double>(mu, cfg_.sigma)(rng_);
+            }
+        }
+        if (cfg_.jitter_us > 0) {
+            us += std::uniform_real_distribution<double>(0, cfg_.jitter_us)(rng_);
+        }
+        return us;
+    }
+
+    Config cfg_;
+    std::mutex mu_;
+    std::mt19937_64 rng_;
+    std::chrono::steady_clock::time_point link_free_;
+    std::atomic<uint64_t> delayed_ops_{0};
+    std::atomic<uint64_t> injected_ns_{0};
+};
+
+// --- Fault-Injecting VFS ---
+//
+// Makes lock, read, write and sync calls on persistent files fail with a
+// configurable probability: SQLITE_BUSY from xLock/xShmLock, SQLITE_IOERR
+// from any I/O, short reads (half the buffer transferred, reported as
+// SQLITE_IOERR_READ so the page is re-read) and SQLITE_FULL from writes. Injection
+// starts off and is only on during measured phases (see SetFaultInjection).
+class FaultVfs : public ShimVfs {
+public:
+    struct Config {
+        double busy_prob = 0;
+        double ioerr_prob = 0;
+        double short_read_prob = 0;
+        double full_prob = 0;
+        uint64_t seed = 1;
+    };
+
+    FaultVfs(sqlite3_vfs* parent, Config cfg) : ShimVfs("faults", parent), cfg_(cfg), rng_(cfg.seed) {}
+
+    void setEnabled(bool enabled) { enabled_ = enabled; }
+
+    std::string stats() const override {
+        std::ostringstream out;
+        out << "injected busy=" << busy_ << " ioerr=" << ioerr_ << " short_read=" << short_reads_ << " full=" << full_;
+        return out.str();
+    }
+
+    void resetStats() override {
+        busy_ = ioerr_ = short_reads_ = full_ = 0;
+    }
+
+protected:
+    int read(ShimFile* f, void* buf, int amt, sqlite3_int64 off) override {
+        if (inject(f, cfg_.ioerr_prob)) {
+            ++ioerr_;
+            return SQLITE_IOERR_READ;
+        }
+        int rc = ShimVfs::read(f, buf, amt, off);
+        if (rc == SQLITE_OK && amt > 1 && inject(f, cfg_.short_read_prob)) {
+            // A transfer cut off halfway. SQLITE_IOERR_SHORT_READ would tell
+            // SQLite the file ends there, and it would cache the zero-filled
+            // page as valid data, which could later be written back as lasting
+            // corruption. So the short read is reported as a failed read.
+            ++short_reads_;
+            int keep = amt / 2;
+            std::memset(static_cast<char*>(buf) + keep, 0, amt - keep);
+            return SQLITE_IOERR_READ;
+        }
+        return rc;
+    }
+
+    int write(ShimFile* f, const void* buf, int amt, sqlite3_int64 off) override {
+        if (inject(f, cfg_.full_prob)) {
+            ++full_;
+            return SQLITE_FULL;
+        }
+        if (inject(f, cfg_.ioerr_prob)) {
+            ++ioerr_;
+            return SQLITE_IOERR_WRITE;
+        }
+        return ShimVfs::write(f, buf, amt, off);
+    }
+
+    int sync(ShimFile* f, int flags) override {
+        if (inject(f, cfg_.ioerr_prob)) {
+            ++ioerr_;
+            return SQLITE_IOERR_FSYNC;
+        }
+        return ShimVfs::sync(f, flags);
+    }
+
+    int lock(ShimFile* f, int level) override {
+        if (inject(f, cfg_.busy_prob)) {
+            ++busy_;
+            return SQLITE_BUSY;
+        }
+        return ShimVfs::lock(f, level);
+    }
+
+    int shmLock(ShimFile* f, int offset, int n, int flags) override {
+        if ((flags & SQLITE_SHM_LOCK) && inject(f, cfg_.busy_prob)) {
+            ++busy_;
+            return SQLITE_BUSY;
+        }
+        return ShimVfs::shmLock(f, offset, n, flags);
+    }
+
+private:
+    bool inject(ShimFile* f, double prob) {
+        if (!enabled_ || prob <= 0 || !isPersistent(f)) return false;
+        std::lock_guard<std::mutex> guard(mu_);
+        return std::uniform_real_distribution<double>(0, 1)(rng_) < prob;
+    }
+
+    Config cfg_;
+    std::atomic<bool> enabled_{false};
+    std::mutex mu_;
+    std::mt19937_64 rng_;
+    std::atomic<uint64_t> busy_{0}, ioerr_{0}, short_reads_{0}, full_{0};
+};
+
+// Turns every fault-injecting layer on or off. Benchmark::run() keeps it off
+// while opening the database, and untimed fills turn it off until they finish.
+void SetFaultInjection(bool enabled) {
+    for (auto& layer : VfsLayers()) {
+        if (auto* faults = dynamic_cast<FaultVfs*>(layer.get())) {
+            faults->setEnabled(enabled);
+        }
+    }
+}
+
+// --- Page Codecs ---
+//
+// Compression algorithms available to the compress VFS. zlib is used whenever
+// its header is present (link with -lz); LZ4 and zstd are opt-in with
+// -DHAVE_LZ4 -llz4 and -DHAVE_ZSTD -lzstd.
+
+class PageCodec {
+public:
+    virtual ~PageCodec() = default;
+    virtual const char* name() const = 0;
+    // Returns the compressed size, or 0 if |src| does not fit into |cap| bytes.
+    virtual size_t compress(const char* src, size_t n, char* dst, size_t cap) const = 0;
+    virtual bool decompress(const char* src, size_t n, char* dst, size_t out_len) const = 0;
+};
+
+#ifdef HAVE_ZLIB
+class ZlibCodec : public PageCodec {
+public:
+    explicit ZlibCodec(int level) : level_(level < 0 ? Z_DEFAULT_COMPRESSION : level) {}
+    const char* name() const override { return "zlib"; }
+    size_t compress(const char* src, size_t n, char* dst, size_t cap) const override {
+        uLongf out = cap;
+        int rc = compress2(reinterpret_cast<Bytef*>(dst), &out, reinterpret_cast<const Bytef*>(src), n, level_);
+        return rc == Z_OK ? out : 0;
+    }
+    bool decompress(const char* src, size_t n, char* dst, size_t out_len) const override {
+        uLongf out = out_len;
+        int rc = uncompress(reinterpret_cast<Bytef*>(dst), &out, reinterpret_cast<const Bytef*>(src), n);
+        return rc == Z_OK && out == out_len;
+    }
+private:
+    int level_;
+};
+#endif
+
+#ifdef HAVE_LZ4
+class Lz4Codec : public PageCodec {
+public:
+    const char* name() const override { return "lz4"; }
+    size_t compress(const char* src, size_t n, char* dst, size_t cap) const override {
+        int out = LZ4_compress_default(src, dst, static_cast<int>(n), static_cast<int>(cap));
+        return out > 0 ? out : 0;
+    }
+    bool decompress(const char* src, size_t n, char* dst, size_t out_len) const override {
+        return LZ4_decompress_safe(src, dst, static_cast<int>(n), static_cast<int>(out_len)) == static_cast<int>(out_len);
+    }
+};
+#endif
+
+#ifdef HAVE_ZSTD
+class ZstdCodec : public PageCodec {
+public:
+    explicit ZstdCodec(int level) : level_(level < 0 ? 3 : level) {}
+    const char* name() const override { return "zstd"; }
+    size_t compress(const char* src, size_t n, char* dst, size_t cap) const override {
+        size_t out = ZSTD_compress(dst, cap, src, n, level_);
+        return ZSTD_isError(out) ? 0 : out;
+    }
+    bool decompress(const char* src, size_t n, char* dst, size_t out_len) const override {
+        return ZSTD_decompress(dst, out_len, src, n) == out_len;
+    }
+private:
+    int level_;
+};
+#endif
+
+// Returns the codec called |name|, or nullptr if it was not compiled in.
+std::unique_ptr<PageCodec> MakePageCodec(const std::string& name, int level) {
+#ifdef HAVE_ZLIB
+    if (name == "zlib") return std::make_unique<ZlibCodec>(level);
+#endif
+#ifdef HAVE_LZ4
+    if (name == "lz4") return std::make_unique<Lz4Codec>();
+#endif
+#ifdef HAVE_ZSTD
+    if (name == "zstd") return std::make_unique<ZstdCodec>(level);
+#endif
+    (void)level;
+    return nullptr;
+}
+
+// --- Compressing VFS ---
+//
+// Stores each main-database page compressed with a PageCodec. Compressed
+// pages are extents in the database file, located through a page map kept in
+// a "<db>-cmap" sidecar file; the map is written back (only dirty entries) and
+// synced after the data on every xSync, and written back without a sync when
+// the last connection closes the file. A page that moves to a new extent
+// leaves its old one unused until the next sync, so the durable map still
+// points at intact data. A new image that fits is written over the old extent
+// in place, though, while the durable map still holds the old length; after a
+// crash such a page is only correct because SQLite's rollback journal or WAL
+// rewrites it during recovery (so journal_mode=OFF gives no such guarantee).
+// WAL and journal files are not compressed, and xFetch never returns a
+// mapping of the compressed file.
+//
+// The database file is unreadable without this VFS, and connections from
+// other processes are not supported: in-process connections share one map.
+class CompressVfs : public ShimVfs {
+public:
+    CompressVfs(sqlite3_vfs* parent, std::unique_ptr<PageCodec> codec)
+        : ShimVfs("compress", parent), codec_(std::move(codec)) {}
+
+    std::string stats() const override {
+        uint64_t logical = logical_bytes_, stored = stored_bytes_;
+        std::ostringstream out;
+        out << "codec=" << codec_->name() << " pages_written=" << pages_written_ << " ratio=" << std::fixed
+            << std::setprecision(3) << (logical ? static_cast<double>(stored) / logical : 0.0)
+            << " raw_pages=" << raw_pages_ << " relocations=" << relocations_ << " pages_read=" << pages_read_
+            << std::setprecision(1) << " compress_ms=" << compress_ns_ / 1e6 << " decompress_ms=" << decompress_ns_ / 1e6;
+        return out.str();
+    }
+
+    void resetStats() override {
+        pages_written_ = logical_bytes_ = stored_bytes_ = raw_pages_ = relocations_ = 0;
+        pages_read_ = compress_ns_ = decompress_ns_ = 0;
+    }
+
+protected:
+    int open(ShimFile* f, const char* name, int) override {
+        if (!isMainDb(f) || name == nullptr) {
+            return SQLITE_OK;
+        }
+        std::lock_guard<std::mutex> guard(registry_mu_);
+        Store*& store = stores_[name];
+        if (!store) {
+            store = new Store;
+            int rc = store->load(parent(), name, f->real);
+            if (rc != SQLITE_OK) {
+                delete store;
+                stores_.erase(name);
+                return rc;
+            }
+        }
+        ++store->refs;
+        f->state = store;
+        return SQLITE_OK;
+    }
+
+    void close(ShimFile* f) override {
+        Store* store = state(f);
+        if (!store) return;
+        std::lock_guard<std::mutex> guard(registry_mu_);
+        if (--store->refs == 0) {
+            {
+                std::lock_guard<std::mutex> store_guard(store->mu);
+                store->persistMap(false);
+            }
+            stores_.erase(store->path);
+            delete store;
+        }
+        f->state = nullptr;
+    }
+
+    int read(ShimFile* f, void* buf, int amt, sqlite3_int64 off) override {
+        Store* s = state(f);
+        if (!s) return ShimVfs::read(f, buf, amt, off);
+        std::lock_guard<std::mutex> guard(s->mu);
+        char* out = static_cast<char*>(buf);
+        sqlite3_int64 end = std::min<sqlite3_int64>(off + amt, s->logical_size);
+        sqlite3_int64 pos = off;
+        while (pos < end) {
+            uint64_t idx = pos / s->chunk;
+            sqlite3_int64 page_start = static_cast<sqlite3_int64>(idx) * s->chunk;
+            int rc = loadPage(s, f->real, idx);
+            if (rc != SQLITE_OK) return rc;
+            sqlite3_int64 n = std::min<sqlite3_int64>(end, page_start + s->chunk) - pos;
+            std::memcpy(out + (pos - off), s->page.data() + (pos - page_start), static_cast<size_t>(n));
+            pos += n;
+        }
+        if (pos < off + amt) {
+            std::memset(out + (pos - off), 0, static_cast<size_t>(off + amt - pos));
+            return SQLITE_IOERR_SHORT_READ;
+        }
+        return SQLITE_OK;
+    }
+
+    int write(ShimFile* f, const void* buf, int amt, sqlite3_int64 off) override {
+        Store* s = state(f);
+        if (!s) return ShimVfs::write(f, buf, amt, off);
+        std::lock_guard<std::mutex> guard(s->mu);
+        if (s->chunk == 0) {
+            s->chunk = static_cast<uint32_t>(amt);
+            s->header_dirty = true;
+        }
+        if (static_cast<uint32_t>(amt) != s->chunk || off % s->chunk != 0) {
+            std::cerr << "compress: unsupported " << amt << "-byte write at offset " << off
+                      << " (page size changed?)" << std::endl;
+            return SQLITE_IOERR_WRITE;
+        }
+        uint64_t idx = off / s->chunk;
+
+        auto t0 = std::chrono::steady_clock::now();
+        s->scratch.resize(s->chunk);
+        size_t len = codec_->compress(static_cast<const char*>(buf), amt, s->scratch.data(), s->chunk - 1);
+        compress_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        const char* image = s->scratch.data();
+        bool raw = len == 0;
+        if (raw) {
+            image = static_cast<const char*>(buf);
+            len = amt;
+            ++raw_pages_;
+        }
+
+        if (idx >= s->map.size()) s->map.resize(idx + 1);
+        Extent& e = s->map[idx];
+        if (e.cap < len) {
+            if (e.cap) {
+                s->deferred_free.push_back(e);
+                ++relocations_;
+            }
+            e.cap = roundCap(len);
+            e.off = s->allocate(e.cap);
+        }
+        e.len = static_cast<uint32_t>(len) | (raw ? kRawFlag : 0);
+        s->dirty.push_back(idx);
+        s->logical_size = std::max<sqlite3_int64>(s->logical_size, off + amt);
+        s->header_dirty = true;
+        if (s->cached_page == idx) s->cached_page = kNoPage;
+
+        ++pages_written_;
+        logical_bytes_ += amt;
+        stored_bytes_ += len;
+        return f->real->pMethods->xWrite(f->real, image, static_cast<int>(len), static_cast<sqlite3_int64>(e.off));
+    }
+
+    int truncate(ShimFile* f, sqlite3_int64 size) override {
+        Store* s = state(f);
+        if (!s) return ShimVfs::truncate(f, size);
+        std::lock_guard<std::mutex> guard(s->mu);
+        s->logical_size = size;
+        s->header_dirty = true;
+        if (s->chunk) {
+            size_t keep = static_cast<size_t>((size + s->chunk - 1) / s->chunk);
+            for (size_t i = keep; i < s->map.size(); ++i) {
+                if (s->map[i].cap) s->deferred_free.push_back(s->map[i]);
+            }
+            if (keep < s->map.size()) s->map.resize(keep);
+            s->cached_page = kNoPage;
+        }
+        return SQLITE_OK;
+    }
+
+    int sync(ShimFile* f, int flags) override {
+        Store* s = state(f);
+        if (!s) return ShimVfs::sync(f, flags);
+        std::lock_guard<std::mutex> guard(s->mu);
+        int rc = ShimVfs::sync(f, flags);  // Data first, so the map never points at unwritten extents.
+        if (rc != SQLITE_OK) return rc;
+        return s->persistMap(true, flags);
+    }
+
+    int fileSize(ShimFile* f, sqlite3_int64* size) override {
+        Store* s = state(f);
+        if (!s) return ShimVfs::fileSize(f, size);
+        std::lock_guard<std::mutex> guard(s->mu);
+        *size = s->logical_size;
+        return SQLITE_OK;
+    }
+
+    int fetch(ShimFile* f, sqlite3_int64 off, int amt, void** out) override {
+        if (state(f)) {
+            *out = nullptr;  // The file holds compressed extents, not pages.
+            return SQLITE_OK;
+        }
+        return ShimVfs::fetch(f, off, amt, out);
+    }
+
+private:
+    static constexpr uint32_t kRawFlag = 0x80000000u;
+    static constexpr uint64_t kNoPage = ~0ull;
+    static constexpr uint64_t kDataStart = 512;  // Keeps plain SQLite from mistaking the file for a database.
+    static constexpr sqlite3_int64 kMapHeader = 64;
+
+    struct Extent {
+        uint64_t off = 0;
+        uint32_t len = 0;  // Stored length; kRawFlag marks an uncompressed page.
+        uint32_t cap = 0;  // Allocated length, 0 if the page was never written.
+    };
+
+    struct MapHeader {
+        char magic[8];
+        uint32_t chunk;
+        uint32_t reserved;
+        int64_t logical_size;
+        uint64_t entries;
+        uint64_t data_end;
+    };
+
+    static uint32_t roundCap(size_t len) { return static_cast<uint32_t>((len + 255) & ~size_t(255)); }
+
+    struct Store {
+        std::mutex mu;
+        int refs = 0;
+        std::string path;
+        std::string map_path;  // Double NUL-terminated, as the parent VFS expects.
+        sqlite3_file* map_file = nullptr;
+        uint32_t chunk = 0;
+        sqlite3_int64 logical_size = 0;
+        uint64_t data_end = kDataStart;
+        bool header_dirty = false;
+        std::vector<Extent> map;
+        std::vector<uint64_t> dirty;
+        std::vector<Extent> deferred_free;
+        std::map<uint32_t, std::vector<uint64_t>> free_extents;  // By capacity.
+        std::vector<char> scratch, page;
+        uint64_t cached_page = kNoPage;
+
+        ~Store() {
+            if (map_file) {
+                if (map_file->pMethods) map_file->pMethods->xClose(map_file);
+                sqlite3_free(map_file);
+            }
+        }
+
+        uint64_t allocate(uint32_t cap) {
+            auto it = free_extents.find(cap);
+            if (it != free_extents.end() && !it->second.empty()) {
+                uint64_t off = it->second.back();
+                it->second.pop_back();
+                return off;
+            }
+            uint64_t off = data_end;
+            data_end += cap;
+            return off;
+        }
+
+        int load(sqlite3_vfs* vfs, const char* name, sqlite3_file* data) {
+            path = name;
+            map_path = path + "-cmap";
+            map_path.push_back('\0');
+            map_file = static_cast<sqlite3_file*>(sqlite3_malloc(vfs->szOsFile));
+            if (!map_file) return SQLITE_NOMEM;
+            std::memset(map_file, 0, vfs->szOsFile);
+            int rc = vfs->xOpen(vfs, map_path.c_str(), map_file,
+                                SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_MAIN_JOURNAL, nullptr);
+            if (rc != SQLITE_OK) return rc;
+
+            sqlite3_int64 data_size = 0;
+            data->pMethods->xFileSize(data, &data_size);
+            MapHeader hdr;
+            rc = map_file->pMethods->xRead(map_file, &hdr, sizeof(hdr), 0);
+            if (data_size == 0 || rc != SQLITE_OK || std::memcmp(hdr.magic, "SQBCMAP1", 8) != 0) {
+                // A new (or externally deleted and recreated) database: start an empty map.
+                header_dirty = true;
+                return map_file->pMethods->xTruncate(map_file, 0);
+            }
+            chunk = hdr.chunk;
+            logical_size = hdr.logical_size;
+            data_end = hdr.data_end;
+            map.resize(hdr.entries);
+            if (!map.empty()) {
+                rc = map_file->pMethods->xRead(map_file, map.data(), static_cast<int>(map.size() * sizeof(Extent)), kMapHeader);
+                if (rc != SQLITE_OK) return SQLITE_CORRUPT;
+            }
+            return SQLITE_OK;
+        }
+
+        // Writes dirty map entries and the header; with |durable|, syncs the
+        // map and then releases extents freed since the previous sync.
+        int persistMap(bool durable, int sync_flags = SQLITE_SYNC_NORMAL) {
+            std::sort(dirty.begin(), dirty.end());
+            dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+            size_t i = 0;
+            while (i < dirty.size()) {
+                size_t j = i;
+                // Coalesce consecutive entries, but stay well below the unix VFS's
+                // 128KB-per-write limit.
+                while (j + 1 < dirty.size() && dirty[j + 1] == dirty[j] + 1 && dirty[j + 1] < map.size() &&
+                       j + 1 - i < 4096) {
+                    ++j;
+                }
+                if (dirty[i] < map.size()) {
+                    int rc = map_file->pMethods->xWrite(map_file, &map[dirty[i]],
+                                                        static_cast<int>((j - i + 1) * sizeof(Extent)),
+                                                        kMapHeader + static_cast<sqlite3_int64>(dirty[i] * sizeof(Extent)));
+                    if (rc != SQLITE_OK) return rc;
+                }
+                i = j + 1;
+            }
+            dirty.clear();
+            if (header_dirty) {
+                MapHeader hdr;
+                std::memset(&hdr, 0, sizeof(hdr));
+                std::memcpy(hdr.magic, "SQBCMAP1", 8);
+                hdr.chunk = chunk;
+                hdr.logical_size = logical_size;
+                hdr.entries = map.size();
+                hdr.data_end = data_end;
+                int rc = map_file->pMethods->xWrite(map_file, &hdr, sizeof(hdr), 0);
+                if (rc != SQLITE_OK) return rc;
+                header_dirty = false;
+            }
+            if (!durable) return SQLITE_OK;
+            int rc = map_file->pMethods->xSync(map_file, sync_flags);
+            if (rc != SQLITE_OK) return rc;
+            for (const Extent& e : deferred_free) {
+                free_extents[e.cap].push_back(e.off);
+            }
+            deferred_free.clear();
+            return SQLITE_OK;
+        }
+    };
+
+    static Store* state(ShimFile* f) { return static_cast<Store*>(f->state); }
+
+    // Decompresses page |idx| into s->page (zeros for never-written pages).
+    int loadPage(Store* s, sqlite3_file* data, uint64_t idx) {
+        if (s->cached_page == idx) return SQLITE_OK;
+        s->page.resize(s->chunk);
+        const Extent* e = idx < s->map.size() ? &s->map[idx] : nullptr;
+        if (!e || e->cap == 0) {
+            std::fill(s->page.begin(), s->page.end(), 0);
+        } else {
+            uint32_t len = e->len & ~kRawFlag;
+            bool raw = (e->len & kRawFlag) != 0;
+            char* dst = raw ? s->page.data() : (s->scratch.resize(len), s->scratch.data());
+            int rc = data->pMethods->xRead(data, dst, static_cast<int>(len), static_cast<sqlite3_int64>(e->off));
+            if (rc != SQLITE_OK) return rc == SQLITE_IOERR_SHORT_READ ? SQLITE_CORRUPT : rc;
+            if (!raw) {
+                auto t0 = std::chrono::steady_clock::now();
+                bool ok = codec_->decompress(dst, len, s->page.data(), s->chunk);
+                decompress_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+                if (!ok) return SQLITE_CORRUPT;
+            }
+            ++pages_read_;
+        }
+        s->cached_page = idx;
+        return SQLITE_OK;
+    }
+
+    std::unique_ptr<PageCodec> codec_;
+    std::mutex registry_mu_;
+    std::map<std::string, Store*> stores_;
+    std::atomic<uint64_t> pages_written_{0}, logical_bytes_{0}, stored_bytes_{0}, raw_pages_{0}, relocations_{0};
+    std::atomic<uint64_t> pages_read_{0}, compress_ns_{0}, decompress_ns_{0};
+};
+
+// --- Write-Coalescing VFS ---
+//
+// Buffers writes that continue where the previous write to the same file
+// ended and issues them as one larger write (up to --coalesce_max_kb). WAL
+// appends, journal appends and checkpoint write-back are mostly sequential and
+// benefit the most. Buffered data is written out before any read or size query
+// that could observe it, and before every sync, lock change and wal-index
+// barrier, so other connections never see a stale file.
+class CoalesceVfs : public ShimVfs {
+public:
+    // The unix VFS masks write sizes to 17 bits, so merged writes stay below 128 KiB.
+    CoalesceVfs(sqlite3_vfs* parent, size_t max_bytes)
+        : ShimVfs("coalesce", parent), max_bytes_(std::min<size_t>(std::max<size_t>(max_bytes, 4096), 127 * 1024)) {}
+
+    std::string stats() const override {
+        uint64_t in = writes_in_, out = writes_out_;
+        std::ostringstream out_str;
+        out_str << "writes_in=" << in << " writes_out=" << out << " coalesce_factor=" << std::fixed
+                << std::setprecision(2) << (out ? static_cast<double>(in) / out : 0.0);
+        return out_str.str();
+    }
+
+    void resetStats() override {
+        writes_in_ = writes_out_ = 0;
+    }
+
+protected:
+    int open(ShimFile* f, const char*, int) override {
+        if (isPersistent(f)) {
+            f->state = new Buffer;
+        }
+        return SQLITE_OK;
+    }
+
+    void close(ShimFile* f) override {
+        Buffer* b = state(f);
+        if (!b) return;
+        std::lock_guard<std::mutex> guard(mu_);
+        flush(f);
+        delete b;
+        f->state = nullptr;
+    }
+
+    int read(ShimFile* f, void* buf, int amt, sqlite3_int64 off) override {
+        Buffer* b = state(f);
+        if (b) {
+            std::lock_guard<std::mutex> guard(mu_);
+            if (!b->data.empty() && off < b->end() && b->start < off + amt) {
+                int rc = flush(f);
+                if (rc != SQLITE_OK) return rc;
+            }
+        }
+        return ShimVfs::read(f, buf, amt, off);
+    }
+
+    int write(ShimFile* f, const void* buf, int amt, sqlite3_int64 off) override {
+        Buffer* b = state(f);
+        if (!b) return ShimVfs::write(f, buf, amt, off);
+        std::lock_guard<std::mutex> guard(mu_);
+        ++writes_in_;
+        const char* p = static_cast<const char*>(buf);
+        if (!b->data.empty() && off >= b->start && off + amt <= b->end()) {
+            std::memcpy(b->data.data() + (off - b->start), p, amt);  // Rewrite inside the buffer.
+            return SQLITE_OK;
+        }
+        if (!b->data.empty() && (off != b->end() || b->data.size() + amt > max_bytes_)) {
+            int rc = flush(f);
+            if (rc != SQLITE_OK) return rc;
+        }
+        if (static_cast<size_t>(amt) >= max_bytes_) {
+            ++writes_out_;
+            return ShimVfs::write(f, buf, amt, off);
+        }
+        if (b->data.empty()) {
+            b->start = off;
+            if (b->data.capacity() < max_bytes_) b->data.reserve(max_bytes_);
+            pending_.push_back(f);
+        }
+        b->data.insert(b->data.end(), p, p + amt);
+        return SQLITE_OK;
+    }
+
+    int truncate(ShimFile* f, sqlite3_int64 size) override {
+        int rc = flushAll();
+        return rc != SQLITE_OK ? rc : ShimVfs::truncate(f, size);
+    }
+    int sync(ShimFile* f, int flags) override {
+        int rc = flushAll();
+        return rc != SQLITE_OK ? rc : ShimVfs::sync(f, flags);
+    }
+    int fileSize(ShimFile* f, sqlite3_int64* size) override {
+        int rc = flushAll();
+        return rc != SQLITE_OK ? rc : ShimVfs::fileSize(f, size);
+    }
+    int lock(ShimFile* f, int level) override {
+        int rc = flushAll();
+        return rc != SQLITE_OK ? rc : ShimVfs::lock(f, level);
+    }
+    int unlock(ShimFile* f, int level) override {
+        int rc = flushAll();
+        return rc != SQLITE_OK ? rc : ShimVfs::unlock(f, level);
+    }
+    int shmLock(ShimFile* f, int offset, int n, int flags) override {
+        int rc = flushAll();
+        return rc != SQLITE_OK ? rc : ShimVfs::shmLock(f, offset, n, flags);
+    }
+    void shmBarrier(ShimFile* f) override {
+        flushAll();
+        ShimVfs::shmBarrier(f);
+    }
+
+private:
+    struct Buffer {
+        sqlite3_int64 start = 0;
+        std::vector<char> data;
+        sqlite3_int64 end() const { return start + static_cast<sqlite3_int64>(data.size()); }
+    };
+
+    static Buffer* state(ShimFile* f) { return static_cast<Buffer*>(f->state); }
+
+    // Caller holds mu_.
+    int flush(ShimFile* f) {
+        Buffer* b = state(f);
+        if (b->data.empty()) return SQLITE_OK;
+        ++writes_out_;
+        int rc = ShimVfs::write(f, b->data.data(), static_cast<int>(b->data.size()), b->start);
+        b->data.clear();
+        pending_.erase(std::remove(pending_.begin(), pending_.end(), f), pending_.end());
+        return rc;
+    }
+
+    // Writes out every file's buffer: WAL frames must reach the file before the
+    // wal-index (which lives on the database file) makes them visible.
+    int flushAll() {
+        std::lock_guard<std::mutex> guard(mu_);
+        int rc = SQLITE_OK;
+        while (!pending_.empty()) {
+            int frc = flush(pending_.back());
+            if (rc == SQLITE_OK) rc = frc;
+        }
+        return rc;
+    }
+
+    size_t max_bytes_;
+    std::mutex mu_;
+    std::vector<ShimFile*> pending_;
+    std::atomic<uint64_t> writes_in_{0}, writes_out_{0};
+};
+
+// --- RAM Read-Cache VFS ---
+//
+// A secondary, LRU-managed page cache below SQLite's pager, limited to
+// --ramcache_mb of memory and optionally compressed with a PageCodec. It holds
+// page-sized reads of the main database and WAL (keyed by file offset) and is
+// kept current by write-through; connections in this process that open the
+// same file share one cache. Smaller reads are served when a cached page
+// covers them; rollback-journal I/O goes straight to the parent VFS.
+class RamCacheVfs : public ShimVfs {
+public:
+    RamCacheVfs(sqlite3_vfs* parent, size_t limit_bytes, std::unique_ptr<PageCodec> codec)
+        : ShimVfs("ramcache", parent), limit_bytes_(limit_bytes), codec_(std::move(codec)) {}
+
+    std::string stats() const override {
+        uint64_t hits = hits_, misses = misses_;
+        std::ostringstream out;
+        out << "hits=" << hits << " misses=" << misses << " hit_rate=" << std::fixed << std::setprecision(3)
+            << (hits + misses ? static_cast<double>(hits) / (hits + misses) : 0.0) << " evictions=" << evictions_
+            << " cached_mb=" << std::setprecision(1) << cached_bytes_ / 1048576.0;
+        if (codec_) out << " codec=" << codec_->name();
+        return out.str();
+    }
+
+    void resetStats() override {
+        hits_ = misses_ = evictions_ = 0;
+    }
+
+protected:
+    int open(ShimFile* f, const char* name, int) override {
+        if (!(f->flags & (SQLITE_OPEN_MAIN_DB | SQLITE_OPEN_WAL)) || name == nullptr) return SQLITE_OK;
+        std::lock_guard<std::mutex> guard(mu_);
+        Cache*& cache = caches_[name];
+        if (!cache) {
+            cache = new Cache;
+            cache->path = name;
+        }
+        ++cache->refs;
+        f->state = cache;
+        return SQLITE_OK;
+    }
+
+    void close(ShimFile* f) override {
+        Cache* cache = state(f);
+        if (!cache) return;
+        std::lock_guard<std::mutex> guard(mu_);
+        if (--cache->refs == 0) {
+            while (!cache->entries.empty()) erase(cache, cache->entries.begin());
+            caches_.erase(cache->path);
+            delete cache;
+        }
+        f->state = nullptr;
+    }
+
+    int read(ShimFile* f, void* buf, int amt, sqlite3_int64 off) override {
+        Cache* cache = state(f);
+        if (!cache) return ShimVfs::read(f, buf, amt, off);
+        {
+            std::lock_guard<std::mutex> guard(mu_);
+            auto it = cache->entries.upper_bound(off);
+            if (it != cache->entries.begin() && (--it)->first + it->second.len >= off + amt) {
+                if (load(it->second, buf, static_cast<int>(off - it->first), amt)) {
+                    lru_.splice(lru_.begin(), lru_, it->second.lru);
+                    ++hits_;
+                    return SQLITE_OK;
+                }
+            }
+            ++misses_;
+        }
+        int rc = ShimVfs::read(f, buf, amt, off);
+        if (rc == SQLITE_OK && amt >= 512) {
+            std::lock_guard<std::mutex> guard(mu_);
+            store(cache, off, buf, amt);
+        }
+        return rc;
+    }
+
+    int write(ShimFile* f, const void* buf, int amt, sqlite3_int64 off) override {
+        Cache* cache = state(f);
+        if (!cache) return ShimVfs::write(f, buf, amt, off);
+        int rc = ShimVfs::write(f, buf, amt, off);
+        std::lock_guard<std::mutex> guard(mu_);
+        invalidate(cache, off, off + amt);
+        if (rc == SQLITE_OK && amt >= 512) store(cache, off, buf, amt);
+        return rc;
+    }
+
+    int truncate(ShimFile* f, sqlite3_int64 size) override {
+        Cache* cache = state(f);
+        if (cache) {
+            std::lock_guard<std::mutex> guard(mu_);
+            invalidate(cache, size, std::numeric_limits<sqlite3_int64>::max());
+        }
+        return ShimVfs::truncate(f, size);
+    }
+
+private:
+    struct Cache;
+    struct LruKey {
+        Cache* cache;
+        sqlite3_int64 off;
+    };
+    struct Entry {
+        int len = 0;
+        bool compressed = false;
+        std::vector<char> data;
+        std::list<LruKey>::iterator lru;
+    };
+    struct Cache {
+        int refs = 0;
+        std::string path;
+        std::map<sqlite3_int64, Entry> entries;
+    };
+
+    static Cache* state(ShimFile* f) { return static_cast<Cache*>(f->state); }
+
+    // Copies |amt| bytes starting |skip| bytes into the cached page.
+    bool load(const Entry& e, void* buf, int skip, int amt) {
+        if (!e.compressed) {
+            std::memcpy(buf, e.data.data() + skip, amt);
+            return true;
+        }
+        if (skip == 0 && amt == e.len) {
+            return codec_->decompress(e.data.data(), e.data.size(), static_cast<char*>(buf), e.len);
+        }
+        scratch_.resize(e.len);
+        if (!codec_->decompress(e.data.data(), e.data.size(), scratch_.data(), e.len)) return false;
+        std::memcpy(buf, scratch_.data() + skip, amt);
+        return true;
+    }
+
+    void store(Cache* cache, sqlite3_int64 off, const void* buf, int amt) {
+        auto it = cache->entries.find(off);
+        if (it != cache->entries.end()) erase(cache, it);
+        Entry e;
+        e.len = amt;
+        if (codec_) {
+            e.data.resize(amt);
+            size_t n = codec_->compress(static_cast<const char*>(buf), amt, e.data.data(), amt - 1);
+            if (n > 0) {
+                e.data.resize(n);
+                e.data.shrink_to_fit();
+                e.compressed = true;
+            }
+        }
+        if (!e.compressed) {
+            e.data.assign(static_cast<const char*>(buf), static_cast<const char*>(buf) + amt);
+        }
+        cached_bytes_ += e.data.size();
+        lru_.push_front(LruKey{cache, off});
+        e.lru = lru_.begin();
+        cache->entries.emplace(off, std::move(e));
+        while (cached_bytes_ > limit_bytes_ && !lru_.empty()) {
+            LruKey victim = lru_.back();
+            erase(victim.cache, victim.cache->entries.find(victim.off));
+            ++evictions_;
+        }
+    }
+
+    void erase(Cache* cache, std::map<sqlite3_int64, Entry>::iterator it) {
+        cached_bytes_ -= it->second.data.size();
+        lru_.erase(it->second.lru);
+        cache->entries.erase(it);
+    }
+
+    // Drops entries overlapping [start, end).
+    void invalidate(Cache* cache, sqlite3_int64 start, sqlite3_int64 end) {
+        auto it = cache->entries.lower_bound(start);
+        if (it != cache->entries.begin()) {
+            auto prev = std::prev(it);
+            if (prev->first + prev->second.len > start) it = prev;
+        }
+        while (it != cache->entries.end() && it->first < end) {
+            erase(cache, it++);
+        }
+    }
+
+    size_t limit_bytes_;
+    std::unique_ptr<PageCodec> codec_;
+    std::mutex mu_;
+    std::map<std::string, Cache*> caches_;
+    std::list<LruKey> lru_;
+    std::vector<char> scratch_;
+    std::atomic<uint64_t> cached_bytes_{0};
+    std::atomic<uint64_t> hits_{0}, misses_{0}, evictions_{0};
+};
+
+// --- mmap Advice VFS ---
+//
+// Applies madvise() to the memory map SQLite reads through when mmap_size > 0.
+// The unix VFS maps the database from offset 0, so the mapping's base is the
+// pointer xFetch returns minus the requested offset. Advice is (re)applied
+// whenever the mapping moves or grows. "prefault" populates the whole mapping
+// up front like MAP_POPULATE (MADV_POPULATE_READ, or touching every page on
+// kernels older than 5.14). Reports the process's page faults per benchmark.
+class MmapAdviceVfs : public ShimVfs {
+public:
+    MmapAdviceVfs(sqlite3_vfs* parent, const std::string& advice) : ShimVfs("mmap", parent), advice_name_(advice) {
+        resetStats();
+    }
+
+    static bool ValidAdvice(const std::string& advice) {
+        return advice == "normal" || advice == "random" || advice == "sequential" || advice == "willneed" ||
+               advice == "hugepage" || advice == "prefault";
+    }
+
+    std::string stats() const override {
+        struct rusage now;
+        getrusage(RUSAGE_SELF, &now);
+        std::ostringstream out;
+        out << "advice=" << advice_name_ << " peak_mapped_mb=" << std::fixed << std::setprecision(1)
+            << peak_mapped_bytes_ / 1048576.0 << " fetches=" << fetches_ << " advised=" << advised_
+            << " minor_faults=" << now.ru_minflt - start_.ru_minflt
+            << " major_faults=" << now.ru_majflt - start_.ru_majflt;
+        if (advise_errors_) out << " advise_errors=" << advise_errors_;
+        return out.str();
+    }
+
+    void resetStats() override {
+        getrusage(RUSAGE_SELF, &start_);
+        peak_mapped_bytes_ = mapped_bytes_.load();
+        fetches_ = advised_ = advise_errors_ = 0;
+    }
+
+protected:
+    int open(ShimFile* f, const char*, int) override {
+        if (isMainDb(f)) f->state = new Mapping;
+        return SQLITE_OK;
+    }
+
+    void close(ShimFile* f) override {
+        Mapping* m = static_cast<Mapping*>(f->state);
+        if (m) mapped_bytes_ -= m->len;
+        delete m;
+        f->state = nullptr;
+    }
+
+    int fetch(ShimFile* f, sqlite3_int64 off, int amt, void** out) override {
+        int rc = ShimVfs::fetch(f, off, amt, out);
+        Mapping* m = static_cast<Mapping*>(f->state);
+        if (rc != SQLITE_OK || *out == nullptr || m == nullptr) return rc;
+        ++fetches_;
+        char* base = static_cast<char*>(*out) - off;
+        std::lock_guard<std::mutex> guard(m->mu);
+        if (base != m->base || static_cast<size_t>(off + amt) > m->len) {
+            sqlite3_int64 size = 0, limit = -1;
+            ShimVfs::fileSize(f, &size);
+            ShimVfs::fileControl(f, SQLITE_FCNTL_MMAP_SIZE, &limit);
+            if (limit >= 0) size = std::min(size, limit);
+            size_t len = std::max<size_t>(size, off + amt);
+            uint64_t mapped = mapped_bytes_ += len - m->len;
+            uint64_t peak = peak_mapped_bytes_;
+            while (mapped > peak && !peak_mapped_bytes_.compare_exchange_weak(peak, mapped)) {
+            }
+            m->base = base;
+            m->len = len;
+            advise(base, len);
+        }
+        return rc;
+    }
+
+private:
+    struct Mapping {
+        std::mutex mu;
+        char* base = nullptr;
+        size_t len = 0;
+    };
+
+    void advise(char* base, size_t len) {
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        len = (len + page - 1) / page * page;
+        int advice = MADV_NORMAL;
+        if (advice_name_ == "random") advice = MADV_RANDOM;
+        else if (advice_name_ == "sequential") advice = MADV_SEQUENTIAL;
+        else if (advice_name_ == "willneed") advice = MADV_WILLNEED;
+        else if (advice_name_ == "hugepage") advice = MADV_HUGEPAGE;
+        else if (advice_name_ == "prefault") {
+#ifdef MADV_POPULATE_READ
+            advice = MADV_POPULATE_READ;
+#else
+            advice = -1;
+#endif
+        }
+        ++advised_;
+        if (advice >= 0 && madvise(base, len, advice) == 0) return;
+        if (advice_name_ == "prefault") {
+            volatile char sink = 0;
+            for (size_t i = 0; i < len; i += page) sink = sink + base[i];
+            return;
+        }
+        ++advise_errors_;
+    }
+
+    std::string advice_name_;
+    struct rusage start_;
+    std::atomic<uint64_t> mapped_bytes_{0}, peak_mapped_bytes_{0};  // Summed over open connections.
+    std::atomic<uint64_t> fetches_{0}, advised_{0}, advise_errors_{0};
+};
+
+// --- Checksum VFS ---
+//
+// A built-in equivalent of SQLite's ext/misc/cksumvfs.c: every page of the main
+// database and WAL ends with an 8-byte checksum in the page's reserved bytes,
+// filled in on write and verified on read (SQLITE_IOERR_DATA on mismatch).
+// Checksums are active once page 1 says the database reserves 8 bytes per
+// page; the Benchmark requests that reserve for new databases through
+// ConfigureChecksums(), so it applies at whatever page_size the PRAGMAs pick.
+//
+// "cksumvfs" is the extension's own algorithm (files stay readable by it);
+// "simd" runs the same Fletcher-style recurrence in 8 independent 32-bit
+// lanes, which SSE2/AVX2 process in parallel instead of one word at a time.
+
+constexpr int kCksumReserve = 8;
+
+void CksumFletcher(const unsigned char* a, int n, unsigned char* out) {
+    uint32_t s1 = 0, s2 = 0;
+    for (int i = 0; i < n; i += 8) {
+        uint32_t x, y;
+        std::memcpy(&x, a + i, 4);
+        std::memcpy(&y, a + i + 4, 4);
+        s1 += x + s2;
+        s2 += y + s1;
+    }
+    std::memcpy(out, &s1, 4);
+    std::memcpy(out + 4, &s2, 4);
+}
+
+// One lane step per 64-byte block: s1[j] += A[j] + s2[j]; s2[j] += B[j] + s1[j],
+// where A and B are the block's first and second eight words.
+void CksumLanesScalar(const unsigned char* a, int blocks, uint32_t* s1, uint32_t* s2) {
+    for (int b = 0; b < blocks; ++b, a += 64) {
+        for (int j = 0; j < 8; ++j) {
+            uint32_t x, y;
+            std::memcpy(&x, a + 4 * j, 4);
+            std::memcpy(&y, a + 32 + 4 * j, 4);
+            s1[j] += x + s2[j];
+            s2[j] += y + s1[j];
+        }
+    }
+}
+
+#if defined(__x86_64__)
+void CksumLanesSse2(const unsigned char* a, int blocks, uint32_t* s1, uint32_t* s2) {
+    __m128i s1lo = _mm_setzero_si128(), s1hi = _mm_setzero_si128();
+    __m128i s2lo = _mm_setzero_si128(), s2hi = _mm_setzero_si128();
+    for (int b = 0; b < blocks; ++b, a += 64) {
+        const __m128i* p = reinterpret_cast<const __m128i*>(a);
+        s1lo = _mm_add_epi32(s1lo, _mm_add_epi32(_mm_loadu_si128(p), s2lo));
+        s1hi = _mm_add_epi32(s1hi, _mm_add_epi32(_mm_loadu_si128(p + 1), s2hi));
+        s2lo = _mm_add_epi32(s2lo, _mm_add_epi32(_mm_loadu_si128(p + 2), s1lo));
+        s2hi = _mm_add_epi32(s2hi, _mm_add_epi32(_mm_loadu_si128(p + 3), s1hi));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(s1), s1lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(s1 + 4), s1hi);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(s2), s2lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(s2 + 4), s2hi);
+}
+
+__attribute__((target("avx2")))
+void CksumLanesAvx2(const unsigned char* a, int blocks, uint32_t* s1, uint32_t* s2) {
+    __m256i v1 = _mm256_setzero_si256(), v2 = _mm256_setzero_si256();
+    for (int b = 0; b < blocks; ++b, a += 64) {
+        const __m256i* p = reinterpret_cast<const __m256i*>(a);
+        v1 = _mm256_add_epi32(v1, _mm256_add_epi32(_mm256_loadu_si256(p), v2));
+        v2 = _mm256_add_epi32(v2, _mm256_add_epi32(_mm256_loadu_si256(p + 1), v1));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(s1), v1);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(s2), v2);
+}
+#endif
+
+using CksumLanesFn = void (*)(const unsigned char*, int, uint32_t*, uint32_t*);
+
+// Picks the widest lane implementation the CPU supports; all give identical sums.
+CksumLanesFn SelectCksumLanes(const char** name) {
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "simd-avx2";
+        return CksumLanesAvx2;
+    }
+    *name = "simd-sse2";
+    return CksumLanesSse2;
+#else
+    *name = "simd-scalar";
+    return CksumLanesScalar;
+#endif
+}
+
+class CksumVfs : public ShimVfs {
+public:
+    CksumVfs(sqlite3_vfs* parent, const std::string& algo, bool verify)
+        : ShimVfs("cksum", parent), verify_(verify) {
+        if (algo == "cksumvfs") {
+            algo_name_ = "cksumvfs";
+        } else {
+            lanes_ = SelectCksumLanes(&algo_name_);
+        }
+    }
+
+    // Reserves the checksum bytes on a database that has no pages yet.
+    void configure(sqlite3* db) {
+        int n = kCksumReserve;
+        if (sqlite3_file_control(db, "main", SQLITE_FCNTL_RESERVE_BYTES, &n) != SQLITE_OK) {
+            std::cerr << "Warning: could not reserve checksum bytes; pages will not be checksummed." << std::endl;
+        }
+    }
+
+    std::string stats() const override {
+        uint64_t pages = computed_ + verified_;
+        std::ostringstream out;
+        out << "algo=" << algo_name_ << " pages_checksummed=" << computed_ << " pages_verified=" << verified_
+            << " failures=" << failures_ << " cksum_ms=" << std::fixed << std::setprecision(1) << cksum_ns_ / 1e6
+            << " ns_per_page=" << std::setprecision(0) << (pages ? static_cast<double>(cksum_ns_) / pages : 0.0);
+        return out.str();
+    }
+
+    void resetStats() override {
+        computed_ = verified_ = failures_ = cksum_ns_ = 0;
+    }
+
+protected:
+    int open(ShimFile* f, const char* name, int) override {
+        if (!(f->flags & (SQLITE_OPEN_MAIN_DB | SQLITE_OPEN_WAL)) || name == nullptr) return SQLITE_OK;
+        // WAL names resolve to their database, so both files share one enabled flag.
+        std::string db = (f->flags & SQLITE_OPEN_WAL) ? sqlite3_filename_database(name) : name;
+        std::lock_guard<std::mutex> guard(mu_);
+        DbState*& shared = dbs_[db];
+        if (!shared) {
+            shared = new DbState;
+            shared->path = db;
+        }
+        ++shared->refs;
+        FileState* fs = new FileState;
+        fs->db = shared;
+        f->state = fs;
+        return SQLITE_OK;
+    }
+
+    void close(ShimFile* f) override {
+        FileState* fs = state(f);
+        if (!fs) return;
+        flushHeader(f);
+        std::lock_guard<std::mutex> guard(mu_);
+        if (--fs->db->refs == 0) {
+            dbs_.erase(fs->db->path);
+            delete fs->db;
+        }
+        delete fs;
+        f->state = nullptr;
+    }
+
+    int read(ShimFile* f, void* buf, int amt, sqlite3_int64 off) override {
+        FileState* fs = state(f);
+        if (!fs) return ShimVfs::read(f, buf, amt, off);
+        int rc = flushHeader(f);
+        if (rc == SQLITE_OK) rc = ShimVfs::read(f, buf, amt, off);
+        if (rc != SQLITE_OK) return rc;
+        const unsigned char* p = static_cast<const unsigned char*>(buf);
+        if ((f->flags & SQLITE_OPEN_WAL) && off == 0 && amt >= 32) {
+            fs->wal.parse(p);
+        }
+        noteHeader(fs, p, amt, off);
+        if (verify_ && fs->db->enabled && isPageSize(amt)) {
+            unsigned char sum[kCksumReserve];
+            compute(p, amt - kCksumReserve, sum);
+            ++verified_;
+            if (std::memcmp(sum, p + amt - kCksumReserve, kCksumReserve) != 0) {
+                ++failures_;
+                sqlite3_log(SQLITE_IOERR_DATA, "checksum fault offset %lld of \"%s\"", off, f->path);
+                return SQLITE_IOERR_DATA;
+            }
+        }
+        return SQLITE_OK;
+    }
+
+    int write(ShimFile* f, const void* buf, int amt, sqlite3_int64 off) override {
+        FileState* fs = state(f);
+        if (!fs) return ShimVfs::write(f, buf, amt, off);
+        const unsigned char* p = static_cast<const unsigned char*>(buf);
+        if (f->flags & SQLITE_OPEN_WAL) {
+            return writeWal(f, fs, p, amt, off);
+        }
+        noteHeader(fs, p, amt, off);
+        if (!fs->db->enabled || !isPageSize(amt)) return ShimVfs::write(f, buf, amt, off);
+        fs->scratch.assign(p, p + amt);
+        compute(fs->scratch.data(), amt - kCksumReserve, fs->scratch.data() + amt - kCksumReserve);
+        ++computed_;
+        return ShimVfs::write(f, fs->scratch.data(), amt, off);
+    }
+
+    int truncate(ShimFile* f, sqlite3_int64 size) override {
+        int rc = flushHeader(f);
+        return rc != SQLITE_OK ? rc : ShimVfs::truncate(f, size);
+    }
+
+    int sync(ShimFile* f, int flags) override {
+        int rc = flushHeader(f);
+        return rc != SQLITE_OK ? rc : ShimVfs::sync(f, flags);
+    }
+
+    // Memory-mapped pages would bypass verification, so mapping is declined
+    // while checksums are active, as cksumvfs does.
+    int fetch(ShimFile* f, sqlite3_int64 off, int amt, void** out) override {
+        FileState* fs = state(f);
+        if (fs && fs->db->enabled) {
+            *out = nullptr;
+            return SQLITE_OK;
+        }
+        return ShimVfs::fetch(f, off, amt, out);
+    }
+
+private:
+    struct DbState {
+        std::string path;
+        int refs = 0;
+        std::atomic<bool> enabled{false};
+    };
+
+    // WAL header fields that stay fixed for the life of a database. Salts and
+    // checksums change on every WAL reset, possibly by another connection, so
+    // they are taken from SQLite's frame headers or the file instead.
+    struct WalHeader {
+        bool valid = false;
+        bool big_endian_cksum = false;
+        uint32_t page_size = 0;
+
+        void parse(const unsigned char* h) {
+            big_endian_cksum = (Get4(h) & 1) != 0;
+            page_size = Get4(h + 8);
+            valid = isPageSize(static_cast<int>(page_size));
+        }
+    };
+
+    struct FileState {
+        DbState* db;
+        std::vector<unsigned char> scratch;
+        WalHeader wal;
+        sqlite3_int64 pending_off = -1;  // Frame header held back until its page arrives.
+        unsigned char pending[24];
+        sqlite3_int64 last_frame_off = -1;  // Chain value of the last frame written.
+        unsigned char last_salt[8];
+        uint32_t last_cksum[2];
+    };
+
+    static FileState* state(ShimFile* f) { return static_cast<FileState*>(f->state); }
+
+    static bool isPageSize(int amt) { return amt >= 512 && amt <= 65536 && (amt & (amt - 1)) == 0; }
+
+    static uint32_t Get4(const unsigned char* p) {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+    }
+    static void Put4(unsigned char* p, uint32_t v) {
+        p[0] = v >> 24;
+        p[1] = v >> 16;
+        p[2] = v >> 8;
+        p[3] = v;
+    }
+
+    // Page 1 carries the reserve size at byte 20; 8 means checksums are on.
+    static void noteHeader(FileState* fs, const unsigned char* p, int amt, sqlite3_int64 off) {
+        if (amt >= 100 && (off == 0 || fs->wal.valid) && std::memcmp(p, "SQLite format 3", 16) == 0) {
+            fs->db->enabled = p[20] == kCksumReserve;
+        }
+    }
+
+    void compute(const unsigned char* p, int n, unsigned char* out) {
+        auto start = std::chrono::steady_clock::now();
+        if (!lanes_) {
+            CksumFletcher(p, n, out);
+        } else {
+            uint32_t s1[8] = {0}, s2[8] = {0};
+            int blocks = n / 64;
+            lanes_(p, blocks, s1, s2);
+            for (int i = blocks * 64; i < n; i += 8) {  // Tail words feed lane 0.
+                uint32_t x, y;
+                std::memcpy(&x, p + i, 4);
+                std::memcpy(&y, p + i + 4, 4);
+                s1[0] += x + s2[0];
+                s2[0] += y + s1[0];
+            }
+            uint32_t a = 0, b = 0;
+            for (int j = 0; j < 8; ++j) {  // Odd weights keep lane order significant.
+                a += s1[j] * (2 * j + 1);
+                b += s2[j] * (2 * j + 1);
+            }
+            std::memcpy(out, &a, 4);
+            std::memcpy(out + 4, &b, 4);
+        }
+        cksum_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // SQLite's WAL checksum (walChecksumBytes), continuing from |ck|.
+    void walChecksum(const WalHeader& h, const unsigned char* a, int n, uint32_t* ck) {
+        bool native = h.big_endian_cksum == (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__);
+        uint32_t s1 = ck[0], s2 = ck[1];
+        for (int i = 0; i < n; i += 8) {
+            uint32_t x, y;
+            std::memcpy(&x, a + i, 4);
+            std::memcpy(&y, a + i + 4, 4);
+            if (!native) {
+                x = __builtin_bswap32(x);
+                y = __builtin_bswap32(y);
+            }
+            s1 += x + s2;
+            s2 += y + s1;
+        }
+        ck[0] = s1;
+        ck[1] = s2;
+    }
+
+    int flushHeader(ShimFile* f) {
+        FileState* fs = state(f);
+        if (!fs || fs->pending_off < 0) return SQLITE_OK;
+        sqlite3_int64 off = fs->pending_off;
+        fs->pending_off = -1;
+        return ShimVfs::write(f, fs->pending, sizeof(fs->pending), off);
+    }
+
+    // SQLite signs each WAL frame over the page before this layer fills in the
+    // page checksum, so frames are re-signed here: the 24-byte frame header is
+    // held until its page is written, then both go out together with the frame
+    // checksum recomputed from the previous frame's (or the WAL header's)
+    // checksum on disk. SQLite recomputes later frames itself whenever it
+    // rewrites an earlier one, so the chain stays whole.
+    int writeWal(ShimFile* f, FileState* fs, const unsigned char* p, int amt, sqlite3_int64 off) {
+        WalHeader& h = fs->wal;
+        if (off == 0 && amt >= 32) {
+            int rc = flushHeader(f);
+            if (rc != SQLITE_OK) return rc;
+            h.parse(p);
+            return ShimVfs::write(f, p, amt, off);
+        }
+        if (!h.valid && off >= 32) {
+            // Another connection wrote the WAL header; this one is appending
+            // to its WAL, so take the fixed fields from the file.
+            unsigned char hdr[32];
+            if (ShimVfs::read(f, hdr, sizeof(hdr), 0) == SQLITE_OK) h.parse(hdr);
+        }
+        const sqlite3_int64 frame = 24 + static_cast<sqlite3_int64>(h.page_size);
+        if (h.valid && amt == 24 && off >= 32 && (off - 32) % frame == 0) {
+            int rc = flushHeader(f);
+            if (rc != SQLITE_OK) return rc;
+            std::memcpy(fs->pending, p, 24);
+            fs->pending_off = off;
+            return SQLITE_OK;
+        }
+        if (fs->pending_off < 0 || off != fs->pending_off + 24 || amt != static_cast<int>(h.page_size)) {
+            int rc = flushHeader(f);
+            if (rc != SQLITE_OK) return rc;
+            // A page rewritten in place within a transaction arrives without a
+            // header; SQLite re-signs its frame at commit (walRewriteChecksums).
+            if (h.valid && fs->db->enabled && amt == static_cast<int>(h.page_size) && off >= 56 &&
+                (off - 56) % frame == 0) {
+                fs->scratch.assign(p, p + amt);
+                compute(fs->scratch.data(), amt - kCksumReserve, fs->scratch.data() + amt - kCksumReserve);
+                ++computed_;
+                return ShimVfs::write(f, fs->scratch.data(), amt, off);
+            }
+            return ShimVfs::write(f, p, amt, off);
+        }
+
+        sqlite3_int64 frame_off = fs->pending_off;
+        fs->pending_off = -1;
+        uint32_t ck[2];
+        sqlite3_int64 prev = frame_off > 32 ? frame_off - frame : 0;
+        if (prev > 0 && prev == fs->last_frame_off && std::memcmp(fs->last_salt, fs->pending + 8, 8) == 0) {
+            ck[0] = fs->last_cksum[0];
+            ck[1] = fs->last_cksum[1];
+        } else {
+            // Both the WAL header and a frame header end with their checksum.
+            unsigned char prev_hdr[32];
+            int n = prev > 0 ? 24 : 32;
+            int rc = ShimVfs::read(f, prev_hdr, n, prev);
+            if (rc != SQLITE_OK) return rc == SQLITE_IOERR_SHORT_READ ? SQLITE_IOERR_WRITE : rc;
+            ck[0] = Get4(prev_hdr + n - 8);
+            ck[1] = Get4(prev_hdr + n - 4);
+        }
+        fs->scratch.resize(24 + amt);
+        unsigned char* out = fs->scratch.data();
+        std::memcpy(out, fs->pending, 16);
+        std::memcpy(out + 24, p, amt);
+        noteHeader(fs, out + 24, amt, 0);
+        if (fs->db->enabled) {
+            compute(out + 24, amt - kCksumReserve, out + 24 + amt - kCksumReserve);
+            ++computed_;
+        }
+        walChecksum(h, out, 8, ck);
+        walChecksum(h, out + 24, amt, ck);
+        Put4(out + 16, ck[0]);
+        Put4(out + 20, ck[1]);
+        fs->last_frame_off = frame_off;
+        std::memcpy(fs->last_salt, out + 8, 8);
+        fs->last_cksum[0] = ck[0];
+        fs->last_cksum[1] = ck[1];
+        return ShimVfs::write(f, out, 24 + amt, frame_off);
+    }
+
+    bool verify_;
+    const char* algo_name_ = nullptr;
+    CksumLanesFn lanes_ = nullptr;
+    std::mutex mu_;
+    std::map<std::string, DbState*> dbs_;
+    std::atomic<uint64_t> computed_{0}, verified_{0}, failures_{0}, cksum_ns_{0};
+};
+
+// Reserves checksum space in a new database when a cksum layer is in the stack.
+void ConfigureChecksums(sqlite3* db) {
+    for (auto& layer : VfsLayers()) {
+        if (auto* cksum = dynamic_cast<CksumVfs*>(layer.get())) {
+            cksum->configure(db);
+        }
+    }
+}
+
+// --- RAM VFS ---
+//
+// Keeps every file in process memory so benchmarks measure SQLite's own CPU
+// and locking cost without any filesystem, not even tmpfs. Unlike memdb it
+// implements the full rollback-journal lock protocol (SHARED, RESERVED,
+// PENDING, EXCLUSIVE) and the wal-index (xShm*) between connections, so WAL
+// mode and multithreaded benchmarks work. A file's contents are dropped once
+// its last handle closes.
+class RamStore {
+public:
+    explicit RamStore(sqlite3_vfs* base) : base_(base) {
+        std::memset(&vfs_, 0, sizeof(vfs_));
+        vfs_.iVersion = 2;
+        vfs_.szOsFile = sizeof(File);
+        vfs_.mxPathname = base->mxPathname;
+        vfs_.zName = "ram-store";
+        vfs_.pAppData = this;
+        vfs_.xOpen = xOpen;
+        vfs_.xDelete = xDelete;
+        vfs_.xAccess = xAccess;
+        vfs_.xFullPathname = xFullPathname;
+        vfs_.xDlOpen = [](sqlite3_vfs*, const char*) -> void* { return nullptr; };
+        vfs_.xDlError = [](sqlite3_vfs*, int n, char* msg) { sqlite3_snprintf(n, msg, "not supported"); };
+        vfs_.xDlSym = [](sqlite3_vfs*, void*, const char*) -> void (*)(void) { return nullptr; };
+        vfs_.xDlClose = [](sqlite3_vfs*, void*) {};
+        vfs_.xRandomness = [](sqlite3_vfs* v, int n, char* out) { return self(v)->base_->xRandomness(self(v)->base_, n, out); };
+        vfs_.xSleep = [](sqlite3_vfs* v, int us) { return self(v)->base_->xSleep(self(v)->base_, us); };
+        vfs_.xCurrentTime = [](sqlite3_vfs* v, double* t) { return self(v)->base_->xCurrentTime(self(v)->base_, t); };
+        vfs_.xGetLastError = [](sqlite3_vfs*, int, char*) { return 0; };
+        vfs_.xCurrentTimeInt64 = [](sqlite3_vfs* v, sqlite3_int64* t) {
+            return self(v)->base_->xCurrentTimeInt64(self(v)->base_, t);
+        };
+
+        std::memset(&methods_, 0, sizeof(methods_));
+        methods_.iVersion = 2;
+        methods_.xClose = xClose;
+        methods_.xRead = xRead;
+        methods_.xWrite = xWrite;
+        methods_.xTruncate = xTruncate;
+        methods_.xSync = [](sqlite3_file*, int) { return SQLITE_OK; };
+        methods_.xFileSize = xFileSize;
+        methods_.xLock = xLock;
+        methods_.xUnlock = xUnlock;
+        methods_.xCheckReservedLock = xCheckReservedLock;
+        methods_.xFileControl = [](sqlite3_file*, int, void*) { return SQLITE_NOTFOUND; };
+        methods_.xSectorSize = [](sqlite3_file*) { return 4096; };
+        methods_.xDeviceCharacteristics = [](sqlite3_file*) {
+            return SQLITE_IOCAP_SAFE_APPEND | SQLITE_IOCAP_SEQUENTIAL | SQLITE_IOCAP_POWERSAFE_OVERWRITE;
+        };
+        methods_.xShmMap = xShmMap;
+        methods_.xShmLock = xShmLock;
+        methods_.xShmBarrier = [](sqlite3_file*) { std::atomic_thread_fence(std::memory_order_seq_cst); };
+        methods_.xShmUnmap = xShmUnmap;
+    }
+
+    sqlite3_vfs* vfs() { return &vfs_; }
+
+    // Number of files and bytes currently held.
+    void usage(size_t* files, size_t* bytes) {
+        std::lock_guard<std::mutex> guard(mu_);
+        *files = nodes_.size();
+        *bytes = 0;
+        for (auto& entry : nodes_) {
+            std::shared_lock<std::shared_mutex> data_guard(entry.second->data_mu);
+            *bytes += entry.second->data.size();
+        }
+    }
+
+private:
+    struct Node {
+        std::string name;
+        int refs = 0;
+        bool linked = true;  // False once deleted (or for temp files); freed on last close.
+
+        std::shared_mutex data_mu;
+        std::vector<char> data;
+
+        std::mutex lock_mu;  // Guards everything below.
+        int shared = 0;
+        bool reserved = false, pending = false, exclusive = false;
+        std::vector<std::unique_ptr<char[]>> shm;
+        int shm_users = 0;
+        int shm_shared[SQLITE_SHM_NLOCK] = {0};
+        bool shm_exclusive[SQLITE_SHM_NLOCK] = {false};
+    };
+
+    struct File {
+        sqlite3_file base;
+        RamStore* store;
+        Node* node;
+        int level;
+        bool has_reserved, has_pending, has_exclusive;
+        bool shm_mapped;
+        uint16_t shm_shared_mask, shm_exclusive_mask;
+    };
+
+    static RamStore* self(sqlite3_vfs* v) { return static_cast<RamStore*>(v->pAppData); }
+    static File* file(sqlite3_file* f) { return reinterpret_cast<File*>(f); }
+
+    static int xOpen(sqlite3_vfs* v, const char* name, sqlite3_file* out, int flags, int* out_flags) {
+        RamStore* store = self(v);
+        File* f = file(out);
+        std::memset(f, 0, sizeof(*f));
+        Node* node;
+        {
+            std::lock_guard<std::mutex> guard(store->mu_);
+            if (name == nullptr) {
+                node = new Node;
+                node->linked = false;
+            } else {
+                auto it = store->nodes_.find(name);
+                if (it == store->nodes_.end()) {
+                    if (!(flags & SQLITE_OPEN_CREATE)) return SQLITE_CANTOPEN;
+                    node = new Node;
+                    node->name = name;
+                    store->nodes_[name] = node;
+                } else {
+                    node = it->second;
+                }
+                if (flags & SQLITE_OPEN_DELETEONCLOSE) {
+                    store->nodes_.erase(name);
+                    node->linked = false;
+                }
+            }
+            ++node->refs;
+        }
+        f->base.pMethods = &store->methods_;
+        f->store = store;
+        f->node = node;
+        if (out_flags) *out_flags = flags;
+        return SQLITE_OK;
+    }
+
+    static int xClose(sqlite3_file* pf) {
+        File* f = file(pf);
+        xUnlock(pf, SQLITE_LOCK_NONE);
+        if (f->shm_mapped) xShmUnmap(pf, 0);
+        RamStore* store = f->store;
+        std::lock_guard<std::mutex> guard(store->mu_);
+        if (--f->node->refs == 0) {
+            if (f->node->linked) store->nodes_.erase(f->node->name);
+            delete f->node;
+        }
+        return SQLITE_OK;
+    }
+
+    static int xDelete(sqlite3_vfs* v, const char* name, int) {
+        RamStore* store = self(v);
+        std::lock_guard<std::mutex> guard(store->mu_);
+        auto it = store->nodes_.find(name);
+        if (it == store->nodes_.end()) return SQLITE_OK;  // E.g., a journal already dropped on close.
+        it->second->linked = false;
+        store->nodes_.erase(it);
+        return SQLITE_OK;
+    }
+
+    // Like the unix VFS, an empty file counts as missing (e.g., a truncated journal).
+    static int xAccess(sqlite3_vfs* v, const char* name, int flags, int* out) {
+        RamStore* store = self(v);
+        std::lock_guard<std::mutex> guard(store->mu_);
+        auto it = store->nodes_.find(name);
+        *out = 0;
+        if (it != store->nodes_.end()) {
+            std::shared_lock<std::shared_mutex> data_guard(it->second->data_mu);
+            *out = flags != SQLITE_ACCESS_EXISTS || !it->second->data.empty();
+        }
+        return SQLITE_OK;
+    }
+
+    static int xFullPathname(sqlite3_vfs*, const char* name, int n, char* out) {
+        sqlite3_snprintf(n, out, "%s", name);
+        return SQLITE_OK;
+    }
+
+    static int xRead(sqlite3_file* pf, void* buf, int amt, sqlite3_int64 off) {
+        Node* node = file(pf)->node;
+        std::shared_lock<std::shared_mutex> guard(node->data_mu);
+        sqlite3_int64 size = static_cast<sqlite3_int64>(node->data.size());
+        sqlite3_int64 n = std::max<sqlite3_int64>(0, std::min<sqlite3_int64>(amt, size - off));
+        if (n > 0) std::memcpy(buf, node->data.data() + off, n);
+        if (n < amt) {
+            std::memset(static_cast<char*>(buf) + n, 0, amt - n);
+            return SQLITE_IOERR_SHORT_READ;
+        }
+        return SQLITE_OK;
+    }
+
+    static int xWrite(sqlite3_file* pf, const void* buf, int amt, sqlite3_int64 off) {
+        Node* node = file(pf)->node;
+        std::unique_lock<std::shared_mutex> guard(node->data_mu);
+        if (static_cast<size_t>(off + amt) > node->data.size()) node->data.resize(off + amt);
+        std::memcpy(node->data.data() + off, buf, amt);
+        return SQLITE_OK;
+    }
+
+    static int xTruncate(sqlite3_file* pf, sqlite3_int64 size) {
+        Node* node = file(pf)->node;
+        std::unique_lock<std::shared_mutex> guard(node->data_mu);
+        if (static_cast<size_t>(size) < node->data.size()) node->data.resize(size);
+        return SQLITE_OK;
+    }
+
+    static int xFileSize(sqlite3_file* pf, sqlite3_int64* size) {
+        Node* node = file(pf)->node;
+        std::shared_lock<std::shared_mutex> guard(node->data_mu);
+        *size = static_cast<sqlite3_int64>(node->data.size());
+        return SQLITE_OK;
+    }
+
+    static int xLock(sqlite3_file* pf, int level) {
+        File* f = file(pf);
+        Node* node = f->node;
+        if (f->level >= level) return SQLITE_OK;
+        std::lock_guard<std::mutex> guard(node->lock_mu);
+        if (level == SQLITE_LOCK_SHARED) {
+            if (node->pending || node->exclusive) return SQLITE_BUSY;
+            ++node->shared;
+        } else if (level == SQLITE_LOCK_RESERVED) {
+            if (node->reserved) return SQLITE_BUSY;
+            node->reserved = f->has_reserved = true;
+        } else {
+            // EXCLUSIVE goes through PENDING, which keeps new readers out while
+            // existing ones finish.
+            if (!f->has_pending) {
+                if (node->pending) return SQLITE_BUSY;
+                node->pending = f->has_pending = true;
+                f->level = SQLITE_LOCK_PENDING;
+            }
+            if (node->shared > 1) return SQLITE_BUSY;
+            node->exclusive = f->has_exclusive = true;
+        }
+        f->level = level;
+        return SQLITE_OK;
+    }
+
+    static int xUnlock(sqlite3_file* pf, int level) {
+        File* f = file(pf);
+        Node* node = f->node;
+        if (f->level <= level) return SQLITE_OK;
+        std::lock_guard<std::mutex> guard(node->lock_mu);
+        if (f->has_reserved) node->reserved = f->has_reserved = false;
+        if (f->has_pending) node->pending = f->has_pending = false;
+        if (f->has_exclusive) node->exclusive = f->has_exclusive = false;
+        if (level == SQLITE_LOCK_NONE) --node->shared;
+        f->level = level;
+        return SQLITE_OK;
+    }
+
+    static int xCheckReservedLock(sqlite3_file* pf, int* out) {
+        Node* node = file(pf)->node;
+        std::lock_guard<std::mutex> guard(node->lock_mu);
+        *out = node->reserved || node->pending || node->exclusive;
+        return SQLITE_OK;
+    }
+
+    static int xShmMap(sqlite3_file* pf, int region, int size, int extend, void volatile** out) {
+        File* f = file(pf);
+        Node* node = f->node;
+        std::lock_guard<std::mutex> guard(node->lock_mu);
+        if (!f->shm_mapped) {
+            f->shm_mapped = true;
+            ++node->shm_users;
+        }
+        while (static_cast<int>(node->shm.size()) <= region && extend) {
+            node->shm.emplace_back(new char[size]());
+        }
+        *out = region < static_cast<int>(node->shm.size()) ? node->shm[region].get() : nullptr;
+        return SQLITE_OK;
+    }
+
+    static int xShmLock(sqlite3_file* pf, int offset, int n, int flags) {
+        File* f = file(pf);
+        Node* node = f->node;
+        uint16_t mask = static_cast<uint16_t>(((1u << n) - 1) << offset);
+        std::lock_guard<std::mutex> guard(node->lock_mu);
+        if (flags & SQLITE_SHM_UNLOCK) {
+            for (int i = offset; i < offset + n; ++i) {
+                if (f->shm_exclusive_mask & (1u << i)) node->shm_exclusive[i] = false;
+                if (f->shm_shared_mask & (1u << i)) --node->shm_shared[i];
+            }
+            f->shm_exclusive_mask &= ~mask;
+            f->shm_shared_mask &= ~mask;
+        } else if (flags & SQLITE_SHM_SHARED) {
+            if (f->shm_shared_mask & mask) return SQLITE_OK;
+            if (node->shm_exclusive[offset]) return SQLITE_BUSY;
+            ++node->shm_shared[offset];
+            f->shm_shared_mask |= mask;
+        } else {
+            for (int i = offset; i < offset + n; ++i) {
+                bool mine = (f->shm_shared_mask & (1u << i)) != 0;
+                if ((node->shm_exclusive[i] && !(f->shm_exclusive_mask & (1u << i))) ||
+                    node->shm_shared[i] - (mine ? 1 : 0) > 0) {
+                    return SQLITE_BUSY;
+                }
+            }
+            for (int i = offset; i < offset + n; ++i) node->shm_exclusive[i] = true;
+            f->shm_exclusive_mask |= mask;
+        }
+        return SQLITE_OK;
+    }
+
+    static int xShmUnmap(sqlite3_file* pf, int delete_flag) {
+        File* f = file(pf);
+        if (!f->shm_mapped) return SQLITE_OK;
+        xShmLock(pf, 0, SQLITE_SHM_NLOCK, SQLITE_SHM_UNLOCK);
+        Node* node = f->node;
+        std::lock_guard<std::mutex> guard(node->lock_mu);
+        f->shm_mapped = false;
+        if (--node->shm_users == 0 && delete_flag) node->shm.clear();
+        return SQLITE_OK;
+    }
+
+    sqlite3_vfs* base_;
+    sqlite3_vfs vfs_;
+    sqlite3_io_methods methods_;
+    std::mutex mu_;
+    std::map<std::string, Node*> nodes_;
+};
+
+// The "ram" layer: a ShimVfs over a RamStore that also counts lock contention.
+// It replaces rather than wraps the default VFS, so it must be the innermost layer.
+class RamVfs : public ShimVfs {
+public:
+    explicit RamVfs(sqlite3_vfs* base) : RamVfs(std::make_unique<RamStore>(base)) {}
+
+    std::string stats() const override {
+        size_t files = 0, bytes = 0;
+        store_->usage(&files, &bytes);
+        std::ostringstream out;
+        out << "files=" << files << " mb=" << std::fixed << std::setprecision(1) << bytes / 1048576.0
+            << " lock_busy=" << lock_busy_ << " shm_busy=" << shm_busy_;
+        return out.str();
+    }
+
+    void resetStats() override {
+        lock_busy_ = shm_busy_ = 0;
+    }
+
+protected:
+    int lock(ShimFile* f, int level) override {
+        int rc = ShimVfs::lock(f, level);
+        if (rc == SQLITE_BUSY) ++lock_busy_;
+        return rc;
+    }
+
+    int shmLock(ShimFile* f, int offset, int n, int flags) override {
+        int rc = ShimVfs::shmLock(f, offset, n, flags);
+        if (rc == SQLITE_BUSY) ++shm_busy_;
+        return rc;
+    }
+
+private:
+    explicit RamVfs(std::unique_ptr<RamStore> store) : ShimVfs("ram", store->vfs()), store_(std::move(store)) {}
+
+    std::unique_ptr<RamStore> store_;
+    std::atomic<uint64_t> lock_busy_{0}, shm_busy_{0};
+};
+
+// --- Temp File Accounting VFS ---
+//
+// Counts I/O on temporary files: sorter spills, temp B-trees (DISTINCT,
+// GROUP BY, materialized views), statement journals and the TEMP database.
+// Reports files opened, MB written and read, and the most temp file data that
+// existed at once. Persistent files pass through uncounted.
+class TempIoVfs : public ShimVfs {
+public:
+    explicit TempIoVfs(sqlite3_vfs* parent) : ShimVfs("tempio", parent) {}
+
+    std::string stats() const override {
+        std::ostringstream out;
+        out << "temp_files=" << files_ << std::fixed << std::setprecision(1)
+            << " temp_write_mb=" << written_ / 1048576.0 << " temp_read_mb=" << read_ / 1048576.0
+            << " temp_peak_mb=" << peak_ / 1048576.0;
+        return out.str();
+    }
+
+    void resetStats() override {
+        files_ = 0;
+        written_ = 0;
+        read_ = 0;
+        peak_ = current_.load();
+    }
+
+protected:
+    int open(ShimFile* f, const char*, int) override {
+        if (isPersistent(f)) return SQLITE_OK;
+        ++files_;
+        f->state = new sqlite3_int64(0);  // Bytes this file holds.
+        return SQLITE_OK;
+    }
+
+    void close(ShimFile* f) override {
+        auto* size = static_cast<sqlite3_int64*>(f->state);
+        if (!size) return;
+        current_ -= *size;
+        delete size;
+        f->state = nullptr;
+    }
+
+    int read(ShimFile* f, void* buf, int amt, sqlite3_int64 off) override {
+        if (f->state) read_ += amt;
+        return ShimVfs::read(f, buf, amt, off);
+    }
+
+    int write(ShimFile* f, const void* buf, int amt, sqlite3_int64 off) override {
+        int rc = ShimVfs::write(f, buf, amt, off);
+        if (f->state && rc == SQLITE_OK) {
+            written_ += amt;
+            resize(f, std::max(*static_cast<sqlite3_int64*>(f->state), off + amt));
+        }
+        return rc;
+    }
+
+    int truncate(ShimFile* f, sqlite3_int64 size) override {
+        int rc = ShimVfs::truncate(f, size);
+        if (f->state && rc == SQLITE_OK) resize(f, std::min(*static_cast<sqlite3_int64*>(f->state), size));
+        return rc;
+    }
+
+private:
+    void resize(ShimFile* f, sqlite3_int64 size) {
+        auto* held = static_cast<sqlite3_int64*>(f->state);
+        uint64_t now = current_ += size - *held;
+        *held = size;
+        uint64_t peak = peak_;
+        while (now > peak && !peak_.compare_exchange_weak(peak, now)) {
+        }
+    }
+
+    std::atomic<uint64_t> files_{0}, written_{0}, read_{0};
+    std::atomic<uint64_t> current_{0}, peak_{0};
+};
+
+// Registers the comma-separated VFS stack in |spec| (outermost layer first) and
+// returns the name of the top-level VFS, or "" to use SQLite's default VFS.
+std::string SetupVfsStack(const std::string& spec, const cxxopts::ParseResult& opts) {
+    if (spec.empty() || spec == "default") {
+        return "";
+    }
+    std::vector<std::string> names = split(spec, ',');
+    sqlite3_vfs* parent = sqlite3_vfs_find(nullptr);
+    for (auto it = names.rbegin(); it != names.rend(); ++it) {
+        const std::string& name = *it;
+        std::unique_ptr<ShimVfs> layer;
+        if (sqlite3_vfs_find(name.c_str())) {
+            std::cerr << "VFS layer '" << name << "' is already registered." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+#ifdef HAVE_IO_URING
+        if (name == "io_uring") {
+            auto uring = std::make_unique<IoUringVfs>(parent, opts["uring_depth"].as<unsigned>(),
+                                                      opts["uring_readahead"].as<int>());
+            if (!uring->ok()) {
+                std::cerr << "io_uring is not available on this system: " << strerror(errno) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            layer = std::move(uring);
+        }
+#endif
+        if (name == "odirect") {
+            layer = std::make_unique<ODirectVfs>(parent, opts["odirect_align"].as<size_t>());
+        }
+        if (name == "latency") {
+            LatencyVfs::Config cfg;
+            cfg.read_us = opts["latency_read_us"].as<double>();
+            cfg.write_us = opts["latency_write_us"].as<double>();
+            cfg.sync_us = opts["latency_sync_us"].as<double>();
+            cfg.dist = opts["latency_dist"].as<std::string>();
+            cfg.sigma = opts["latency_sigma"].as<double>();
+            cfg.jitter_us = opts["latency_jitter_us"].as<double>();
+            cfg.bandwidth_mbps = opts["latency_bandwidth_mbps"].as<double>();
+            cfg.seed = opts["latency_seed"].as<uint64_t>();
+            layer = std::make_unique<LatencyVfs>(parent, cfg);
+        }
+        if (name == "faults") {
+            FaultVfs::Config cfg;
+            cfg.busy_prob = opts["fault_busy_prob"].as<double>();
+            cfg.ioerr_prob = opts["fault_ioerr_prob"].as<double>();
+            cfg.short_read_prob = opts["fault_short_read_prob"].as<double>();
+            cfg.full_prob = opts["fault_full_prob"].as<double>();
+            cfg.seed = opts["fault_seed"].as<uint64_t>();
+            layer = std::make_unique<FaultVfs>(parent, cfg);
+        }
+        if (name == "compress") {
+            std::string codec_name = opts["compress_codec"].as<std::string>();
+            auto codec = MakePageCodec(codec_name, opts["compress_level"].as<int>());
+            if (!codec) {
+                std::cerr << "Compression codec '" << codec_name << "' is not compiled in." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            layer = std::make_unique<CompressVfs>(parent, std::move(codec));
+        }
+        if (name == "ram") {
+            if (it != names.rbegin()) {
+                std::cerr << "The ram VFS stores files itself and must be the last (innermost) layer." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            layer = std::make_unique<RamVfs>(parent);
+        }
+        if (name == "mmap") {
+            std::string advice = opts["mmap_advice"].as<std::string>();
+            if (!MmapAdviceVfs::ValidAdvice(advice)) {
+                std::cerr << "Unknown mmap advice '" << advice << "'." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            layer = std::make_unique<MmapAdviceVfs>(parent, advice);
+        }
+        if (name == "cksum") {
+            std::string algo = opts["cksum_algo"].as<std::string>();
+            if (algo != "cksumvfs" && algo != "simd") {
+                std::cerr << "Unknown checksum algorithm '" << algo << "' (use cksumvfs or simd)." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            layer = std::make_unique<CksumVfs>(parent, algo, opts["cksum_verify"].as<bool>());
+        }
+        if (name == "tempio") {
+            layer = std::make_unique<TempIoVfs>(parent);
+        }
+        if (name == "coalesce") {
+            layer = std::make_unique<CoalesceVfs>(parent, opts["coalesce_max_kb"].as<size_t>() * 1024);
+        }
+        if (name == "ramcache") {
+            std::string codec_name = opts["ramcache_codec"].as<std::string>();
+            std::unique_ptr<PageCodec> codec;
+            if (codec_name != "none") {
+                codec = MakePageCodec(codec_name, -1);
+                if (!codec) {
+                    std::cerr << "Compression codec '" << codec_name << "' is not compiled in." << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+            }
+            layer = std::make_unique<RamCacheVfs>(parent, opts["ramcache_mb"].as<size_t>() << 20, std::move(codec));
+        }
+        if (!layer) {
+            std::cerr << "Unknown VFS layer: " << name << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        CheckSqliteError(sqlite3_vfs_register(layer->vfs(), 0), "register VFS " + name);
+        parent = layer->vfs();
+        VfsLayers().push_back(std::move(layer));
+    }
+    return VfsLayers().back()->name();
+}
+
+// --- Schema ---
+
+// Layout of the benchmark table. Benchmarks address rows by an integer key;
+// the schema maps it to the key columns (an INTEGER, a prefixed string, a
+// UUID, a random BLOB or an (INTEGER, INTEGER) pair), so a key written by one
+// benchmark can be found again by another. The default is SQLite's fastest
+// layout, an INTEGER PRIMARY KEY aliasing the rowid with one BLOB value.
+//
+// With secondary indexes, the table also gets three columns derived from the
+// key, standing in for attributes of the value: a (a 24-bit id), b (a 63-bit
+// number) and c (a mixed-case email-like string). Each index kind covers them
+// differently:
+//   plain      (a)
+//   covering   (b, c), so a lookup by b never visits the table
+//   partial    (c) WHERE a < kPartialLimit, about 10% of the rows
+//   expression (lower(c))
+class Schema {
+public:
+    static bool ValidKeyType(const std::string& type) {
+        return type == "int" || type == "text" || type == "uuid" || type == "blob" || type == "composite";
+    }
+
+    static bool ValidIndexKind(const std::string& kind) {
+        return kind == "plain" || kind == "covering" || kind == "partial" || kind == "expression";
+    }
+
+    Schema() = default;
+    Schema(std::string key_type, bool without_rowid, int key_size, int value_columns, int value_size)
+        : key_type_(std::move(key_type)),
+          without_rowid_(without_rowid),
+          key_size_(key_size),
+          value_columns_(std::max(1, value_columns)),
+          value_size_(value_size) {}
+
+    void setIndexes(std::vector<std::string> kinds) {
+        indexes_ = std::move(kinds);
+    }
+
+    const std::vector<std::string>& indexes() const { return indexes_; }
+
+    std::string describe() const {
+        std::ostringstream out;
+        out << key_type_;
+        if (key_type_ == "text" || key_type_ == "blob") out << "(" << key_size_ << ")";
+        out << (without_rowid_ ? " WITHOUT ROWID" : "") << ", " << value_columns_ << " value column"
+            << (value_columns_ == 1 ? "" : "s");
+        for (size_t i = 0; i < indexes_.size(); ++i) out << (i ? "," : ", indexes: ") << indexes_[i];
+        return out.str();
+    }
+
+    std::string createSql() const {
+        std::string sql = "CREATE TABLE IF NOT EXISTS test (";
+        if (key_type_ == "composite") {
+            sql += "grp INTEGER, key INTEGER, ";
+        } else {
+            sql += std::string("key ") + (key_type_ == "int" ? "INTEGER" : key_type_ == "blob" ? "BLOB" : "TEXT") +
+                   " PRIMARY KEY, ";
+        }
+        if (!indexes_.empty()) sql += "a INTEGER, b INTEGER, c TEXT, ";
+        for (int i = 0; i < value_columns_; ++i) {
+            sql += valueColumn(i) + " BLOB, ";
+        }
+        sql.resize(sql.size() - 2);
+        if (key_type_ == "composite") sql += ", PRIMARY KEY (grp, key)";
+        sql += without_rowid_ ? ") WITHOUT ROWID;" : ");";
+        return sql;
+    }
+
+    // An INSERT of |rows| rows in one statement, paramsPerRow() parameters each.
+    std::string insertSql(bool replace = false, int rows = 1) const {
+        std::string cols = keyColumns(), params = key_type_ == "composite" ? "(?, ?" : "(?";
+        if (!indexes_.empty()) {
+            cols += ", a, b, c";
+            params += ", ?, ?, ?";
+        }
+        for (int i = 0; i < value_columns_; ++i) {
+            cols += ", " + valueColumn(i);
+            params += ", ?";
+        }
+        params += ")";
+        std::string sql = std::string(replace ? "INSERT OR REPLACE" : "INSERT") + " INTO test (" + cols + ") VALUES ";
+        for (int i = 0; i < rows; ++i) sql += (i ? ", " : "") + params;
+        return sql;
+    }
+
+    int paramsPerRow() const {
+        return (key_type_ == "composite" ? 2 : 1) + (indexes_.empty() ? 0 : 3) + value_columns_;
+    }
+
+    std::string selectSql() const {
+        return "SELECT " + valueColumns() + " FROM test WHERE " +
+               (key_type_ == "composite" ? "grp = ? AND key = ?" : "key = ?");
+    }
+
+    std::string scanSql() const {
+        return "SELECT " + keyColumns() + ", " + valueColumns() + " FROM test ORDER BY " + keyColumns();
+    }
+
+    // Every row in table order (rowid, or primary key WITHOUT ROWID), or in
+    // |order| when given.
+    std::string exportSql(const std::string& order = "") const {
+        return "SELECT " + keyColumns() + ", " + valueColumns() + " FROM test" + (order.empty() ? "" : " ORDER BY " + order);
+    }
+
+    // An ORDER BY that the first full (non-partial) secondary index can
+    // satisfy, or "" if there is none.
+    std::string indexOrder() const {
+        for (const auto& kind : indexes_) {
+            if (kind == "plain") return "a";
+            if (kind == "covering") return "b, c";
+            if (kind == "expression") return "lower(c)";
+        }
+        return "";
+    }
+
+    // Sets the value columns (parameters 1..value columns), then the key.
+    std::string updateSql() const {
+        std::string sql = "UPDATE test SET ";
+        for (int i = 0; i < value_columns_; ++i) sql += (i ? ", " : "") + valueColumn(i) + " = ?";
+        return sql + " WHERE " + (key_type_ == "composite" ? "grp = ? AND key = ?" : "key = ?");
+    }
+
+    std::string deleteSql() const {
+        return std::string("DELETE FROM test WHERE ") + (key_type_ == "composite" ? "grp = ? AND key = ?" : "key = ?");
+    }
+
+    int valueColumnCount() const { return value_columns_; }
+
+    // One CREATE INDEX statement per configured index, named test_idx<N>.
+    std::vector<std::string> indexSql() const {
+        std::vector<std::string> sql;
+        for (size_t i = 0; i < indexes_.size(); ++i) {
+            const std::string& kind = indexes_[i];
+            std::string def = kind == "plain"      ? "(a)"
+                              : kind == "covering" ? "(b, c)"
+                              : kind == "partial"  ? "(c) WHERE a < " + std::to_string(kPartialLimit)
+                                                   : "(lower(c))";
+            sql.push_back("CREATE INDEX IF NOT EXISTS test_idx" + std::to_string(i) + " ON test " + def);
+        }
+        return sql;
+    }
+
+    std::vector<std::string> dropIndexSql() const {
+        std::vector<std::string> sql;
+        for (size_t i = 0; i < indexes_.size(); ++i) sql.push_back("DROP INDEX IF EXISTS test_idx" + std::to_string(i));
+        return sql;
+    }
+
+    // A statement that needs a large sort with no index to help (sort
+    // benchmark). The sort key is an expression of the key column that no
+    // index provides and whose order is unrelated to the key's: "orderby"
+    // returns every row in its order, "distinct" dedupes it, "groupby" groups
+    // on its first four hex digits and "createindex" indexes it as
+    // test_sort_idx.
+    std::string sortSql(const std::string& kind) const {
+        const std::string expr = "substr(hex(key), -4) || hex(key)";
+        if (kind == "orderby") return "SELECT " + keyColumns() + ", " + valueColumns() + " FROM test ORDER BY " + expr;
+        if (kind == "distinct") return "SELECT DISTINCT " + expr + " FROM test";
+        if (kind == "groupby") {
+            return "SELECT substr(hex(key), -4), count(*), sum(length(" + valueColumn(0) + ")) FROM test GROUP BY 1";
+        }
+        return "CREATE INDEX test_sort_idx ON test (" + expr + ")";
+    }
+
+    // A point query that the |kind| index answers; bind it with bindLookup().
+    std::string lookupSql(const std::string& kind) const {
+        if (kind == "plain") return "SELECT " + keyColumns() + " FROM test WHERE a = ?";
+        if (kind == "covering") return "SELECT c FROM test WHERE b = ?";
+        if (kind == "partial") {
+            return "SELECT " + keyColumns() + " FROM test WHERE c = ? AND a < " + std::to_string(kPartialLimit);
+        }
+        return "SELECT " + keyColumns() + " FROM test WHERE lower(c) = ?";
+    }
+
+    void bindLookup(sqlite3_stmt* stmt, const std::string& kind, int64_t key) const {
+        if (kind == "plain") {
+            sqlite3_bind_int64(stmt, 1, AttrA(key));
+        } else if (kind == "covering") {
+            sqlite3_bind_int64(stmt, 1, AttrB(key));
+        } else {
+            char buf[40];
+            int n = AttrC(key, buf, kind == "expression");
+            sqlite3_bind_text(stmt, 1, buf, n, SQLITE_TRANSIENT);
+        }
+    }
+
+    // Binds the key columns for |key| from parameter |first| and returns the
+    // next free parameter index.
+    int bindKey(sqlite3_stmt* stmt, int64_t key, int first = 1) const {
+        if (key_type_ == "int") {
+            sqlite3_bind_int64(stmt, first, key);
+            return first + 1;
+        }
+        if (key_type_ == "composite") {
+            sqlite3_bind_int64(stmt, first, key % kGroups);
+            sqlite3_bind_int64(stmt, first + 1, key / kGroups);
+            return first + 2;
+        }
+        // Keys up to 63 bytes stay on the stack; longer --key_size values get a
+        // buffer of their own.
+        char small[64];
+        std::string large;
+        char* buf = small;
+        size_t capacity = sizeof(small);
+        if (key_size_ >= static_cast<int>(sizeof(small))) {
+            large.resize(key_size_ + 1);
+            buf = &large[0];
+            capacity = large.size();
+        }
+        if (key_type_ == "text") {
+            // Shared prefix plus zero-padded digits: sorted like the integer key.
+            int n = snprintf(buf, capacity, "key:%0*lld", std::max(1, key_size_ - 4), static_cast<long long>(key));
+            sqlite3_bind_text(stmt, first, buf, n, SQLITE_TRANSIENT);
+        } else if (key_type_ == "uuid") {
+            uint64_t hi = Mix(key), lo = Mix(hi);
+            snprintf(buf, capacity, "%08llx-%04llx-%04llx-%04llx-%012llx",
+                     static_cast<unsigned long long>(hi >> 32), static_cast<unsigned long long>((hi >> 16) & 0xffff),
+                     static_cast<unsigned long long>(hi & 0xffff), static_cast<unsigned long long>(lo >> 48),
+                     static_cast<unsigned long long>(lo & 0xffffffffffffULL));
+            sqlite3_bind_text(stmt, first, buf, 36, SQLITE_TRANSIENT);
+        } else {
+            // Random bytes; the first 8 are a bijection of the key, so keys stay unique.
+            uint64_t h = static_cast<uint64_t>(key);
+            const int n = key_size_;
+            for (int i = 0; i < n; i += 8) {
+                h = Mix(h);
+                for (int b = 0; b < 8 && i + b < n; ++b) buf[i + b] = static_cast<char>(h >> (56 - 8 * b));
+            }
+            sqlite3_bind_blob(stmt, first, buf, n, SQLITE_TRANSIENT);
+        }
+        return first + 1;
+    }
+
+    // Binds |data| (|size| bytes, default value_size) split across the value
+    // columns.
+    void bindValue(sqlite3_stmt* stmt, int first, const char* data, int size = -1) const {
+        if (size < 0) size = value_size_;
+        int width = size / value_columns_;
+        for (int i = 0; i < value_columns_; ++i) {
+            int len = i == value_columns_ - 1 ? size - width * i : width;
+            sqlite3_bind_blob(stmt, first + i, data + width * i, len, SQLITE_STATIC);
+        }
+    }
+
+    // Orders keys like the table's primary key, so inserting in sortKey()
+    // order appends to the B-tree.
+    uint64_t sortKey(int64_t key) const {
+        if (key_type_ == "uuid" || key_type_ == "blob") return Mix(key);
+        if (key_type_ == "composite") return static_cast<uint64_t>(key % kGroups) << 58 | static_cast<uint64_t>(key / kGroups);
+        return static_cast<uint64_t>(key);
+    }
+
+    void bindRow(sqlite3_stmt* stmt, int64_t key, const ValueGenerator::Value& value) const {
+        bindRow(stmt, key, value.data, value.size);
+    }
+
+    // Binds a whole row from parameter |first|; see paramsPerRow().
+    void bindRow(sqlite3_stmt* stmt, int64_t key, const char* data, int size = -1, int first = 1) const {
+        int next = bindKey(stmt, key, first);
+        if (!indexes_.empty()) {
+            char buf[40];
+            int n = AttrC(key, buf, false);
+            sqlite3_bind_int64(stmt, next, AttrA(key));
+            sqlite3_bind_int64(stmt, next + 1, AttrB(key));
+            sqlite3_bind_text(stmt, next + 2, buf, n, SQLITE_TRANSIENT);
+            next += 3;
+        }
+        bindValue(stmt, next, data, size);
+    }
+
+private:
+    static constexpr int kGroups = 64;  // Distinct leading values of a composite key.
+    static constexpr int64_t kPartialLimit = (1 << 24) / 10;
+
+    static int64_t AttrA(int64_t key) { return static_cast<int64_t>(Mix(key ^ 0xa) >> 40); }
+    static int64_t AttrB(int64_t key) { return static_cast<int64_t>(Mix(key ^ 0xb) >> 1); }
+    static int AttrC(int64_t key, char* buf, bool lower) {
+        return snprintf(buf, 40, lower ? "user%016llx@example.com" : "User%016llX@Example.com",
+                        static_cast<unsigned long long>(Mix(key ^ 0xc)));
+    }
+
+    // splitmix64's finalizer: a bijection on 64-bit values.
+    static uint64_t Mix(uint64_t z) {
+        z += 0x9e3779b97f4a7c15ULL;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    std::string keyColumns() const { return key_type_ == "composite" ? "grp, key" : "key"; }
+
+    std::string valueColumn(int i) const { return value_columns_ == 1 ? "value" : "value" + std::to_string(i); }
+
+    std::string valueColumns() const {
+        std::string cols;
+        for (int i = 0; i < value_columns_; ++i) cols += (i ? ", " : "") + valueColumn(i);
+        return cols;
+    }
+
+    std::string key_type_ = "int";
+    bool without_rowid_ = false;
+    int key_size_ = 16;
+    int value_columns_ = 1;
+    int value_size_ = 100;
+    std::vector<std::string> indexes_;
+};
+
+// The prepared statements of one transactional worker (tpcb, tpcc). exec()
+// and query() bind their arguments to ?1..?N, step once and reset, and
+// return SQLITE_OK or the step's error, so a transaction body can hand a
+// SQLITE_BUSY straight back to the retry loop.
+class TxnStatements {
+public:
+    explicit TxnStatements(sqlite3* db) : db_(db) {}
+    ~TxnStatements() {
+        for (sqlite3_stmt* stmt : stmts_) sqlite3_finalize(stmt);
+    }
+    TxnStatements(const TxnStatements&) = delete;
+    TxnStatements& operator=(const TxnStatements&) = delete;
+
+    size_t prepare(const std::string& sql) {
+        sqlite3_stmt* stmt;
+        CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare " + sql, db_);
+        stmts_.push_back(stmt);
+        return stmts_.size() - 1;
+    }
+
+    template <typename... Args>
+    int exec(size_t id, Args... args) {
+        return query(id, nullptr, args...);
+    }
+
+    // Like exec(), and stores column 0 of the first row in |*out| (0 if the
+    // statement returned no row).
+    template <typename... Args>
+    int query(size_t id, double* out, Args... args) {
+        sqlite3_stmt* stmt = stmts_[id];
+        int index = 0;
+        (bind(stmt, ++index, args), ...);
+        int rc = sqlite3_step(stmt);
+        if (out) *out = rc == SQLITE_ROW ? sqlite3_column_double(stmt, 0) : 0;
+        sqlite3_reset(stmt);
+        return rc == SQLITE_ROW || rc == SQLITE_DONE ? SQLITE_OK : rc;
+    }
+
+private:
+    static void bind(sqlite3_stmt* stmt, int index, int64_t v) { sqlite3_bind_int64(stmt, index, v); }
+    static void bind(sqlite3_stmt* stmt, int index, int v) { sqlite3_bind_int64(stmt, index, v); }
+    static void bind(sqlite3_stmt* stmt, int index, double v) { sqlite3_bind_double(stmt, index, v); }
+    static void bind(sqlite3_stmt* stmt, int index, const char* v) {
+        sqlite3_bind_text(stmt, index, v, -1, SQLITE_STATIC);
+    }
+
+    sqlite3* db_;
+    std::vector<sqlite3_stmt*> stmts_;
+};
+
+// --- Benchmark Class ---
+
+class Benchmark {
+private:
+    sqlite3* db_ = nullptr;
+    std::string db_path_;
+    std::string vfs_name_;
+    int num_entries_;
+    int value_size_;
+    std::vector<std::string> pragmas_;
+    std::mt19937_64 rng_;
+    double compression_ratio_ = 0;
+    std::shared_ptr<const ValueSizes> value_sizes_;  // Null for fixed-size values.
+    int max_retries_ = 10;
+    int retry_backoff_us_ = 100;
+    int threads_ = 4;
+    int sorter_threads_ = 4;
+    int bulkload_cache_mb_ = 1024;
+    std::string ingest_file_ = "/tmp/sqlite_benchmark_ingest.csv";
+    std::string export_file_ = "/tmp/sqlite_benchmark_export";
+    size_t export_buffer_ = 4 << 20;
+    std::vector<int> blob_sizes_ = {4096, 65536, 1 << 20, 4 << 20};
+    int blob_chunk_ = 65536;
+    int blob_mb_ = 64;
+    int ingest_batch_ = 10000;
+    int ingest_rows_per_insert_ = 64;
+    int age_ops_ = 0;  // 0 = --num.
+    int vacuum_purge_pct_ = 25;
+    int vacuum_step_pages_ = 1000;
+    bool dbstat_report_ = false;
+    int analytics_reps_ = 3;
+    int oltp_txns_ = 10000;
+    std::vector<std::string> sort_temp_stores_ = {"file", "memory"};
+    std::vector<int> sort_cache_mb_ = {2, 64};
+    std::vector<int> sort_threads_ = {0, 4};
+    int fts_vocab_ = 50000;
+    double fts_zipf_ = 1.0;
+    int fts_doc_words_ = 100;
+    std::vector<int> fts_batches_ = {100, 10000};
+    int fts_queries_ = 1000;
+    int fts_merge_pages_ = 500;
+    std::string json_format_ = "text";
+    int json_depth_ = 2;
+    int json_fields_ = 8;
+    int json_queries_ = 1000;
+    std::vector<double> mmap_fractions_;
+    std::vector<double> cache_fractions_;
+    std::vector<std::string> sized_pragmas_;  // mmap_size/cache_size for the current fraction.
+    std::string name_suffix_;
+    Schema schema_;
+
+    // URIs such as "file:/bench?vfs=memdb" name a database shared by every
+    // connection in the process; like :memory:, there is no file to remove.
+    bool isUri() const { return db_path_.compare(0, 5, "file:") == 0; }
+
+    sqlite3* openConnection() {
+        sqlite3* db = nullptr;
+        int rc = sqlite3_open_v2(db_path_.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_URI,
+                                 vfs_name_.empty() ? nullptr : vfs_name_.c_str());
+        CheckSqliteError(rc, "Cannot open database: " + db_path_, db);
+        return db;
+    }
+
+    void applyPragmas(sqlite3* db) {
+        std::vector<std::string> all = pragmas_;
+        all.insert(all.end(), sized_pragmas_.begin(), sized_pragmas_.end());
+        for (const auto& pragma_str : all) {
+            char* err_msg = nullptr;
+            std::string full_pragma = "PRAGMA " + pragma_str + ";";
+            int rc = sqlite3_exec(db, full_pragma.c_str(), 0, 0, &err_msg);
+            if (rc != SQLITE_OK) {
+                std::cerr << "Failed to execute PRAGMA: " << full_pragma << std::endl;
+                std::cerr << "  Error: " << err_msg << std::endl;
+                sqlite3_free(err_msg);
+                sqlite3_close(db);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    void openDatabase() {
+        if (db_path_ != ":memory:" && !isUri()) {
+            unlink(db_path_.c_str());
+        }
+
+        db_ = openConnection();
+        if (!vfs_name_.empty()) {
+            ConfigureChecksums(db_);
+        }
+        applyPragmas(db_);
+
+        int rc;
+        std::string create_sql = schema_.createSql();
+        char* err_msg = nullptr;
+        rc = sqlite3_exec(db_, create_sql.c_str(), 0, 0, &err_msg);
+        if (rc != SQLITE_OK) {
+            std::cerr << "Failed to create table." << std::endl;
+            std::cerr << "  Error: " << err_msg << std::endl;
+            sqlite3_free(err_msg);
+            sqlite3_close(db_);
+            exit(EXIT_FAILURE);
+        }
+        execAll(schema_.indexSql());
+    }
+
+    void execAll(const std::vector<std::string>& statements) {
+        for (const auto& sql : statements) {
+            CheckSqliteError(sqlite3_exec(db_, sql.c_str(), 0, 0, 0), sql, db_);
+        }
+    }
+
+    void closeDatabase() {
+        if (db_) {
+            sqlite3_close(db_);
+            db_ = nullptr;
+        }
+    }
+
+    void report(const std::string& name, int num_ops, double duration_sec) {
+        double ops_per_sec = num_ops / duration_sec;
+        // Always a space before the colon, so long names still split into
+        // "name : N ops/sec" fields for run_all_benchmarks.sh.
+        std::cout << std::left << std::setw(19) << name + name_suffix_ << " : "
+                  << std::fixed << std::setprecision(2) << ops_per_sec
+                  << " ops/sec (" << num_ops << " ops in " << duration_sec << "s)" << std::endl;
+        PrintVfsStats();
+        ResetVfsStats();
+    }
+
+public:
+    Benchmark(std::string path, int num, int val_size, std::string pragma_str, std::string vfs_name = "")
+        : db_path_(std::move(path)),
+          vfs_name_(std::move(vfs_name)),
+          num_entries_(num),
+          value_size_(val_size) {
+        
+        if (!pragma_str.empty()) {
+            pragmas_ = split(pragma_str, ',');
+        }
+        std::random_device rd;
+        rng_.seed(rd());
+    }
+
+    ~Benchmark() {
+        closeDatabase();
+    }
+
+    void setCompressionRatio(double ratio) {
+        compression_ratio_ = ratio;
+    }
+
+    void setValueSizes(std::shared_ptr<const ValueSizes> sizes) {
+        value_sizes_ = std::move(sizes);
+    }
+
+    ValueGenerator makeValues(char filler, uint64_t seed) const {
+        return ValueGenerator(value_size_, compression_ratio_, filler, seed, value_sizes_);
+    }
+
+    void setRetryPolicy(int max_retries, int backoff_us) {
+        max_retries_ = max_retries;
+        retry_backoff_us_ = backoff_us;
+    }
+
+    void setThreads(int threads) {
+        threads_ = std::max(1, threads);
+    }
+
+    void setSorterThreads(int threads) {
+        sorter_threads_ = std::max(0, threads);
+    }
+
+    void setBulkloadCache(int mb) {
+        bulkload_cache_mb_ = std::max(1, mb);
+    }
+
+    void setIngest(std::string file, int batch, int rows_per_insert) {
+        ingest_file_ = std::move(file);
+        ingest_batch_ = std::max(1, batch);
+        ingest_rows_per_insert_ = std::max(1, rows_per_insert);
+    }
+
+    void setExport(std::string file_prefix, size_t buffer_bytes) {
+        export_file_ = std::move(file_prefix);
+        export_buffer_ = std::max<size_t>(4096, buffer_bytes);
+    }
+
+    void setBlobIo(std::vector<int> sizes, int chunk, int mb) {
+        blob_sizes_ = std::move(sizes);
+        blob_chunk_ = std::max(1, chunk);
+        blob_mb_ = std::max(1, mb);
+    }
+
+    void setAgeOps(int ops) {
+        age_ops_ = std::max(0, ops);
+    }
+
+    void setVacuum(int purge_pct, int step_pages) {
+        vacuum_purge_pct_ = std::clamp(purge_pct, 0, 100);
+        vacuum_step_pages_ = std::max(1, step_pages);
+    }
+
+    void setAnalyticsReps(int reps) {
+        analytics_reps_ = reps;
+    }
+
+    void setOltpTxns(int txns) {
+        oltp_txns_ = txns;
+    }
+
+    void setSortSweep(std::vector<std::string> temp_stores, std::vector<int> cache_mb, std::vector<int> threads) {
+        sort_temp_stores_ = std::move(temp_stores);
+        sort_cache_mb_ = std::move(cache_mb);
+        sort_threads_ = std::move(threads);
+    }
+
+    void setFts(int vocab, double zipf, int doc_words, std::vector<int> batches, int queries, int merge_pages) {
+        fts_vocab_ = vocab;
+        fts_zipf_ = zipf;
+        fts_doc_words_ = doc_words;
+        if (!batches.empty()) fts_batches_ = std::move(batches);
+        fts_queries_ = queries;
+        fts_merge_pages_ = merge_pages;
+    }
+
+    void setJson(std::string format, int depth, int fields, int queries) {
+        json_format_ = std::move(format);
+        json_depth_ = depth;
+        json_fields_ = fields;
+        json_queries_ = queries;
+    }
+
+    void setDbstatReport(bool enabled) {
+        dbstat_report_ = enabled;
+    }
+
+    void setSchema(Schema schema) {
+        schema_ = std::move(schema);
+    }
+
+    void setSizeFractions(std::vector<double> mmap_fractions, std::vector<double> cache_fractions) {
+        mmap_fractions_ = std::move(mmap_fractions);
+        cache_fractions_ = std::move(cache_fractions);
+    }
+
+    void run(const std::vector<std::string>& benchmarks_to_run) {
+        std::cout << "--- Benchmark Configuration ---" << std::endl;
+        std::cout << "Database path: " << db_path_ << std::endl;
+        std::cout << "Entries:       " << num_entries_ << std::endl;
+        std::cout << "Value Size:    " << (value_sizes_ ? value_sizes_->describe() : std::to_string(value_size_) + " bytes")
+                  << std::endl;
+        std::cout << "VFS:           " << (vfs_name_.empty() ? "default" : vfs_name_) << std::endl;
+        std::cout << "Schema:        " << schema_.describe() << std::endl;
+        std::cout << "PRAGMAs:       ";
+        if (pragmas_.empty()) {
+            std::cout << "[defaults]";
+        } else {
+            for(size_t i = 0; i < pragmas_.size(); ++i) {
+                std::cout << pragmas_[i] << (i == pragmas_.size() - 1 ? "" : ", ");
+            }
+        }
+        std::cout << "\n-----------------------------" << std::endl;
+
+        for (const auto& bench_name : benchmarks_to_run) {
+            SetFaultInjection(false);
+            openDatabase();
+            SetFaultInjection(true);
+            ResetVfsStats();
+            // --- MODIFIED: Added call to readseq benchmark ---
+            if (bench_name == "fillseq") fillSequential();
+            else if (bench_name == "fillrandom") fillRandom();
+            else if (bench_name == "readrandom") {
+                fillRandom(true);
+                runSized([this] { readRandom(); });
+            } else if (bench_name == "readseq") {
+                fillRandom(true);
+                runSized([this] { readSequential(); });
+            } else if (bench_name == "readwrite") {
+                fillRandom(true);
+                runSized([this] { readWrite(); }, true);
+            } else if (bench_name == "resilience") {
+                fillSequential(true);
+                resilience();
+            } else if (bench_name == "indexlookup") {
+                fillRandom(true);
+                runSized([this] { indexLookup(); });
+            } else if (bench_name == "createindex") {
+                SetFaultInjection(false);  // Setup, like the fill; the fill turns injection back on.
+                execAll(schema_.dropIndexSql());
+                fillRandom(true);
+                createIndex();
+            } else if (bench_name == "bulkload") {
+                bulkLoad();
+            } else if (bench_name == "gencsv") {
+                generateCsv();
+            } else if (bench_name == "ingest") {
+                if (access(ingest_file_.c_str(), R_OK) != 0) generateCsv(true);
+                ingest();
+            } else if (bench_name == "export") {
+                fillRandom(true);
+                exportAll();
+            } else if (bench_name == "blobio") {
+                blobIo();
+            } else if (bench_name == "age") {
+                std::vector<int64_t> keys;
+                fillRandom(true, &keys);
+                printBtreeStats("fresh");
+                name_suffix_ = "@fresh";
+                readSequential();
+                readRandom();
+                name_suffix_.clear();
+                ageDatabase(keys, false);
+                printBtreeStats("aged");
+                name_suffix_ = "@aged";
+                readSequential();
+                readRandom();
+                name_suffix_.clear();
+            } else if (bench_name == "vacuum" || bench_name == "vacuum_into" || bench_name == "incremental_vacuum") {
+                vacuum(bench_name);
+            } else if (bench_name == "analytics") {
+                analytics();
+            } else if (bench_name == "tpcb") {
+                tpcb();
+            } else if (bench_name == "tpcc") {
+                tpcc();
+            } else if (bench_name == "sort") {
+                fillRandom(true);
+                sort();
+            } else if (bench_name == "fts") {
+                fts();
+            } else if (bench_name == "jsondoc") {
+                jsonDocs();
+            } else if (bench_name == "readrandom_mt") {
+                fillRandom(true);
+                runSized([this] { readRandomMultiThreaded(false); });
+            } else if (bench_name == "readwhilewriting") {
+                fillRandom(true);
+                runSized([this] { readRandomMultiThreaded(true); }, true);
+            } else {
+                std::cerr << "Unknown benchmark: " << bench_name << std::endl;
+            }
+            closeDatabase();
+        }
+    }
+
+    std::string pragmaText(const char* name) {
+        sqlite3_stmt* stmt;
+        std::string sql = std::string("PRAGMA ") + name;
+        CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare " + sql, db_);
+        std::string value;
+        if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0)) {
+            value = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        }
+        sqlite3_finalize(stmt);
+        return value;
+    }
+
+    sqlite3_int64 pragmaInt(const char* name) {
+        sqlite3_stmt* stmt;
+        std::string sql = std::string("PRAGMA ") + name;
+        CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare " + sql, db_);
+        sqlite3_int64 value = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+        sqlite3_finalize(stmt);
+        return value;
+    }
+
+    // Runs |bench| once per combination of --mmap_fraction and --cache_fraction,
+    // with mmap_size and cache_size set to that fraction of the database as
+    // loaded (page_count * page_size). Each run is reported as, e.g.,
+    // "readrandom@mmap0.50@cache1.00" and starts with SQLite's cache emptied.
+    // A |bench| that |writes| changes the table, so every combination after
+    // the first runs on a freshly loaded database instead.
+    template <typename Fn>
+    void runSized(Fn bench, bool writes = false) {
+        if (mmap_fractions_.empty() && cache_fractions_.empty()) {
+            bench();
+            return;
+        }
+        const sqlite3_int64 db_bytes = pragmaInt("page_count") * pragmaInt("page_size");
+        std::cout << "  db_size bytes=" << db_bytes << std::endl;
+        std::vector<double> mmap = mmap_fractions_.empty() ? std::vector<double>{-1} : mmap_fractions_;
+        std::vector<double> cache = cache_fractions_.empty() ? std::vector<double>{-1} : cache_fractions_;
+        bool first = true;
+        for (double m : mmap) {
+            for (double c : cache) {
+                sized_pragmas_.clear();
+                if (writes && !first) {
+                    closeDatabase();
+                    SetFaultInjection(false);
+                    openDatabase();
+                    fillRandom(true);
+                }
+                first = false;
+                std::ostringstream suffix;
+                suffix << std::fixed << std::setprecision(2);
+                if (m >= 0) {
+                    sized_pragmas_.push_back("mmap_size=" + std::to_string(static_cast<sqlite3_int64>(m * db_bytes)));
+                    suffix << "@mmap" << m;
+                }
+                if (c >= 0) {
+                    sqlite3_int64 kib = std::max<sqlite3_int64>(1, static_cast<sqlite3_int64>(c * db_bytes / 1024));
+                    sized_pragmas_.push_back("cache_size=-" + std::to_string(kib));
+                    suffix << "@cache" << c;
+                }
+                for (const auto& pragma_str : sized_pragmas_) {
+                    std::string sql = "PRAGMA " + pragma_str;
+                    CheckSqliteError(sqlite3_exec(db_, sql.c_str(), 0, 0, 0), sql, db_);
+                }
+                sqlite3_db_release_memory(db_);
+                name_suffix_ = suffix.str();
+                ResetVfsStats();
+                bench();
+            }
+        }
+        sized_pragmas_.clear();
+        name_suffix_.clear();
+    }
+
+    // With |silent|, an untimed load: no report, and no injected faults.
+    void fillSequential(bool silent = false) {
+        SetFaultInjection(!silent);
+        sqlite3_stmt* stmt;
+        std::string sql = schema_.insertSql();
+        CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare insert", db_);
+
+        ValueGenerator values = makeValues('x', rng_());
+        auto start = std::chrono::high_resolution_clock::now();
+
+        CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
+        for (int i = 0; i < num_entries_; ++i) {
+            schema_.bindRow(stmt, i, values.nextValue());
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                CheckSqliteError(SQLITE_ERROR, "step insert", db_);
+            }
+            sqlite3_reset(stmt);
+        }
+        CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+
+        sqlite3_finalize(stmt);
+        
+        if (!silent) {
+            report("fillseq", num_entries_, elapsed.count());
+            printDbstatReport("fillseq");
+        } else {
+            ResetVfsStats();
+            SetFaultInjection(true);
+        }
+    }
+
+    // Inserts --num rows with random keys; |keys|, if given, receives the keys
+    // actually stored. With |silent|, an untimed load without injected faults.
+    void fillRandom(bool silent = false, std::vector<int64_t>* keys = nullptr) {
+        SetFaultInjection(!silent);
+        sqlite3_stmt* stmt;
+        std::string sql = schema_.insertSql();
+        CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare insert", db_);
+
+        ValueGenerator values = makeValues('x', rng_());
+        std::uniform_int_distribution<int64_t> dist(0, num_entries_ * 10);
+        auto start = std::chrono::high_resolution_clock::now();
+
+        CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
+        for (int i = 0; i < num_entries_; ++i) {
+            int64_t key = dist(rng_);
+            schema_.bindRow(stmt, key, values.nextValue());
+            if (sqlite3_step(stmt) == SQLITE_DONE && keys) keys->push_back(key);
+            sqlite3_reset(stmt);
+        }
+        CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        
+        sqlite3_finalize(stmt);
+        
+        if (!silent) {
+            report("fillrandom", num_entries_, elapsed.count());
+            printDbstatReport("fillrandom");
+        } else {
+            ResetVfsStats();
+            SetFaultInjection(true);
+        }
+    }
+
+    void readRandom() {
+        sqlite3_stmt* stmt;
+        std::string sql = schema_.selectSql();
+        CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare select", db_);
+        
+        std::uniform_int_distribution<int64_t> dist(0, num_entries_ - 1);
+        int found_count = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+
+        for (int i = 0; i < num_entries_; ++i) {
+            schema_.bindKey(stmt, dist(rng_));
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                found_count++;
+            }
+            sqlite3_reset(stmt);
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+
+        sqlite3_finalize(stmt);
+        report("readrandom", num_entries_, elapsed.count());
+    }
+
+    // --- MODIFIED: Added new readSequential benchmark function ---
+    void readSequential() {
+        sqlite3_stmt* stmt;
+        std::string sql = schema_.scanSql();
+        CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare select", db_);
+        
+        int found_count = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            found_count++;
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+
+        sqlite3_finalize(stmt);
+        report("readseq", found_count, elapsed.count());
+    }
+
+    void readWrite() {
+        sqlite3_stmt* read_stmt;
+        std::string read_sql = schema_.selectSql();
+        CheckSqliteError(sqlite3_prepare_v2(db_, read_sql.c_str(), -1, &read_stmt, nullptr), "prepare read", db_);
+        
+        sqlite3_stmt* write_stmt;
+        std::string write_sql = schema_.insertSql(true);
+        CheckSqliteError(sqlite3_prepare_v2(db_, write_sql.c_str(), -1, &write_stmt, nullptr), "prepare write", db_);
+
+        std::uniform_int_distribution<int64_t> key_dist(0, num_entries_ - 1);
+        std::uniform_int_distribution<int> op_dist(0, 1);
+        ValueGenerator values = makeValues('y', rng_());
+        auto start = std::chrono::high_resolution_clock::now();
+
+        CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
+        for (int i = 0; i < num_entries_; ++i) {
+            int64_t key = key_dist(rng_);
+            if (op_dist(rng_) == 0) {
+                schema_.bindKey(read_stmt, key);
+                sqlite3_step(read_stmt);
+                sqlite3_reset(read_stmt);
+            } else {
+                schema_.bindRow(write_stmt, key, values.nextValue());
+                sqlite3_step(write_stmt);
+                sqlite3_reset(write_stmt);
+            }
+        }
+        CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+
+        sqlite3_finalize(read_stmt);
+        sqlite3_finalize(write_stmt);
+        report("readwrite", num_entries_, elapsed.count());
+    }
+
+    // The same rows as fillrandom, loaded the way a nightly ingest would: the
+    // key stream is generated up front and radix-sorted into primary-key order
+    // (on --sorter_threads threads), rows are inserted without secondary
+    // indexes under journal_mode=OFF, synchronous=OFF and a
+    // --bulkload_cache_mb page cache, then the indexes are built and the
+    // original settings restored. The timing covers all of it.
+    void bulkLoad() {
+        struct Item {
+            uint64_t order;
+            int64_t key;
+        };
+        const std::string journal_mode = pragmaText("journal_mode");
+        const sqlite3_int64 synchronous = pragmaInt("synchronous");
+        const sqlite3_int64 cache_size = pragmaInt("cache_size");
+        const sqlite3_int64 threads = pragmaInt("threads");
+        execAll(schema_.dropIndexSql());
+
+        std::uniform_int_distribution<int64_t> dist(0, num_entries_ * 10);
+        std::vector<Item> items(num_entries_);
+        for (auto& item : items) {
+            item.key = dist(rng_);
+            item.order = schema_.sortKey(item.key);
+        }
+        ValueGenerator values = makeValues('x', rng_());
+        sqlite3_stmt* stmt;
+        std::string sql = schema_.insertSql();
+        CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare insert", db_);
+        auto start = std::chrono::high_resolution_clock::now();
+
+        ParallelRadixSort(items, &Item::order, std::max(1, sorter_threads_));
+        auto sorted = std::chrono::high_resolution_clock::now();
+
+        execAll({"PRAGMA journal_mode=OFF", "PRAGMA synchronous=OFF",
+                 "PRAGMA cache_size=-" + std::to_string(static_cast<int64_t>(bulkload_cache_mb_) * 1024)});
+        CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
+        int rows = 0;
+        for (size_t i = 0; i < items.size(); ++i) {
+            if (i > 0 && items[i].key == items[i - 1].key) continue;
+            schema_.bindRow(stmt, items[i].key, values.nextValue());
+            if (sqlite3_step(stmt) != SQLITE_DONE) {
+                CheckSqliteError(SQLITE_ERROR, "step insert", db_);
+            }
+            sqlite3_reset(stmt);
+            ++rows;
+        }
+        CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+        auto loaded = std::chrono::high_resolution_clock::now();
+
+        execAll({"PRAGMA threads=" + std::to_string(sorter_threads_)});
+        execAll(schema_.indexSql());
+        execAll({"PRAGMA threads=" + std::to_string(threads), "PRAGMA journal_mode=" + journal_mode,
+                 "PRAGMA synchronous=" + std::to_string(synchronous), "PRAGMA cache_size=" + std::to_string(cache_size)});
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        std::chrono::duration<double> sort_time = sorted - start, load_time = loaded - sorted, index_time = end - loaded;
+
+        sqlite3_finalize(stmt);
+        report("bulkload", num_entries_, elapsed.count());
+        std::cout << "  rows=" << rows << " sort_threads=" << std::max(1, sorter_threads_) << std::fixed
+                  << std::setprecision(3) << " sort=" << sort_time.count() << "s load=" << load_time.count()
+                  << "s index=" << index_time.count() << "s" << std::endl;
+        printDbstatReport("bulkload");
+    }
+
+    // Writes --num rows of "key<delim>value" (tab-separated if --ingest_file
+    // ends in .tsv, else commas) after a header line. Keys are 0..num-1 and
+    // values are --value_size printable bytes that never contain a delimiter
+    // or quote.
+    void generateCsv(bool silent = false) {
+        const char delim = ingestDelimiter();
+        FILE* out = fopen(ingest_file_.c_str(), "w");
+        if (!out) {
+            std::cerr << "Cannot create " << ingest_file_ << ": " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::vector<char> buffer(1 << 20);
+        setvbuf(out, buffer.data(), _IOFBF, buffer.size());
+        ValueGenerator values = makeValues('x', rng_());
+        std::string value;
+        auto start = std::chrono::high_resolution_clock::now();
+
+        fprintf(out, "key%cvalue\n", delim);
+        for (int i = 0; i < num_entries_; ++i) {
+            ValueGenerator::Value v = values.nextValue();
+            value.resize(v.size);
+            for (int j = 0; j < v.size; ++j) {
+                char c = v.data[j];
+                value[j] = c == ',' || c == '"' || c == '\t' ? '_' : c;
+            }
+            fprintf(out, "%d%c", i, delim);
+            fwrite(value.data(), 1, value.size(), out);
+            fputc('\n', out);
+        }
+        long bytes = ftell(out);
+        if (fclose(out) != 0) {
+            std::cerr << "Cannot write " << ingest_file_ << ": " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+        if (!silent) {
+            report("gencsv", num_entries_, elapsed.count());
+        }
+        std::cout << "  file=" << ingest_file_ << " mb=" << std::fixed << std::setprecision(1) << bytes / 1048576.0
+                  << std::endl;
+    }
+
+    char ingestDelimiter() const {
+        const std::string ext = ".tsv";
+        bool tsv = ingest_file_.size() >= ext.size() &&
+                   ingest_file_.compare(ingest_file_.size() - ext.size(), ext.size(), ext) == 0;
+        return tsv ? '\t' : ',';
+    }
+
+    // Imports --ingest_file. The file is mapped and split at line boundaries
+    // into one slice per --threads parser thread; parsers turn lines into
+    // batches of --ingest_batch typed rows whose values point into the mapping,
+    // and hand them to this thread through a bounded queue. This thread is the
+    // only writer: one transaction per batch, --ingest_rows_per_insert rows per
+    // INSERT statement. The line whose key is not an integer (the header) is
+    // skipped, and surrounding double quotes are stripped from values.
+    //
+    // Parse capacity is bytes over the parsers' busy time (excluding time
+    // blocked on a full queue) divided by the thread count; insert throughput
+    // is rows over the writer's busy time. The slower one is the bottleneck.
+    void ingest() {
+        struct Row {
+            int64_t key;
+            const char* value;
+            int len;
+        };
+        using Batch = std::vector<Row>;
+
+        int fd = open(ingest_file_.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            std::cerr << "Cannot open " << ingest_file_ << ": " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        const size_t size = st.st_size;
+        const char* data = static_cast<const char*>(
+            size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr);
+        close(fd);
+        if (data == MAP_FAILED) {
+            std::cerr << "Cannot map " << ingest_file_ << ": " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if (size) madvise(const_cast<char*>(data), size, MADV_SEQUENTIAL);
+        const char delim = ingestDelimiter();
+
+        std::vector<size_t> bounds(threads_ + 1, size);
+        bounds[0] = 0;
+        for (int t = 1; t < threads_; ++t) {
+            size_t from = std::max(bounds[t - 1], size * t / threads_);
+            const void* nl = from < size ? memchr(data + from, '\n', size - from) : nullptr;
+            bounds[t] = nl ? static_cast<const char*>(nl) - data + 1 : size;
+        }
+
+        std::mutex mu;
+        std::condition_variable ready_cv, space_cv;
+        std::deque<Batch> queue;
+        const size_t max_queued = 2 * threads_;
+        int parsers_running = threads_;
+        std::atomic<uint64_t> bad_lines{0};
+        std::vector<double> parse_busy(threads_, 0);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> parsers;
+        for (int t = 0; t < threads_; ++t) {
+            parsers.emplace_back([&, t] {
+                std::chrono::duration<double> blocked(0);
+                auto parse_start = std::chrono::high_resolution_clock::now();
+                auto push = [&](Batch& batch) {
+                    std::unique_lock<std::mutex> lock(mu);
+                    auto wait_start = std::chrono::high_resolution_clock::now();
+                    space_cv.wait(lock, [&] { return queue.size() < max_queued; });
+                    blocked += std::chrono::high_resolution_clock::now() - wait_start;
+                    queue.push_back(std::move(batch));
+                    ready_cv.notify_one();
+                };
+                Batch batch;
+                batch.reserve(ingest_batch_);
+                const char* p = data + bounds[t];
+                const char* end = data + bounds[t + 1];
+                while (p < end) {
+                    const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+                    if (!eol) eol = end;
+                    const char* line_end = eol > p && eol[-1] == '\r' ? eol - 1 : eol;
+                    const char* q = p;
+                    bool negative = q < line_end && *q == '-';
+                    if (negative) ++q;
+                    int64_t key = 0;
+                    const char* digits = q;
+                    while (q < line_end && *q >= '0' && *q <= '9') key = key * 10 + (*q++ - '0');
+                    if (q == digits || q == line_end || *q != delim) {
+                        if (line_end > p) ++bad_lines;
+                    } else {
+                        const char* value = q + 1;
+                        const char* value_end = static_cast<const char*>(memchr(value, delim, line_end - value));
+                        if (!value_end) value_end = line_end;
+                        if (value_end - value >= 2 && *value == '"' && value_end[-1] == '"') {
+                            ++value;
+                            --value_end;
+                        }
+                        batch.push_back({negative ? -key : key, value, static_cast<int>(value_end - value)});
+                        if (static_cast<int>(batch.size()) == ingest_batch_) {
+                            push(batch);
+                            batch = Batch();
+                            batch.reserve(ingest_batch_);
+                        }
+                    }
+                    p = eol + 1;
+                }
+                if (!batch.empty()) push(batch);
+                std::chrono::duration<double> busy = std::chrono::high_resolution_clock::now() - parse_start;
+                parse_busy[t] = (busy - blocked).count();
+                std::lock_guard<std::mutex> lock(mu);
+                --parsers_running;
+                ready_cv.notify_one();
+            });
+        }
+
+        const int params = schema_.paramsPerRow();
+        const int per_insert =
+            std::max(1, std::min(ingest_rows_per_insert_, sqlite3_limit(db_, SQLITE_LIMIT_VARIABLE_NUMBER, -1) / params));
+        sqlite3_stmt* multi;
+        sqlite3_stmt* single;
+        std::string multi_sql = schema_.insertSql(true, per_insert);
+        std::string single_sql = schema_.insertSql(true);
+        CheckSqliteError(sqlite3_prepare_v2(db_, multi_sql.c_str(), -1, &multi, nullptr), "prepare batch insert", db_);
+        CheckSqliteError(sqlite3_prepare_v2(db_, single_sql.c_str(), -1, &single, nullptr), "prepare insert", db_);
+        std::chrono::duration<double> writer_busy(0), writer_idle(0);
+        uint64_t rows = 0, batches = 0;
+        for (;;) {
+            Batch batch;
+            {
+                std::unique_lock<std::mutex> lock(mu);
+                auto wait_start = std::chrono::high_resolution_clock::now();
+                ready_cv.wait(lock, [&] { return !queue.empty() || parsers_running == 0; });
+                writer_idle += std::chrono::high_resolution_clock::now() - wait_start;
+                if (queue.empty()) break;
+                batch = std::move(queue.front());
+                queue.pop_front();
+                space_cv.notify_one();
+            }
+            auto insert_start = std::chrono::high_resolution_clock::now();
+            CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
+            size_t i = 0;
+            for (; i + per_insert <= batch.size(); i += per_insert) {
+                for (int r = 0; r < per_insert; ++r) {
+                    const Row& row = batch[i + r];
+                    schema_.bindRow(multi, row.key, row.value, row.len, 1 + r * params);
+                }
+                if (sqlite3_step(multi) != SQLITE_DONE) CheckSqliteError(SQLITE_ERROR, "step batch insert", db_);
+                sqlite3_reset(multi);
+            }
+            for (; i < batch.size(); ++i) {
+                schema_.bindRow(single, batch[i].key, batch[i].value, batch[i].len);
+                if (sqlite3_step(single) != SQLITE_DONE) CheckSqliteError(SQLITE_ERROR, "step insert", db_);
+                sqlite3_reset(single);
+            }
+            CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+            writer_busy += std::chrono::high_resolution_clock::now() - insert_start;
+            rows += batch.size();
+            ++batches;
+        }
+        for (auto& p : parsers) p.join();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+
+        sqlite3_finalize(multi);
+        sqlite3_finalize(single);
+        if (size) munmap(const_cast<char*>(data), size);
+        double parse_seconds = 0;
+        for (double s : parse_busy) parse_seconds += s;
+        parse_seconds /= threads_;
+        double parse_rows_per_sec = parse_seconds > 0 ? rows / parse_seconds : 0;
+        double insert_rows_per_sec = writer_busy.count() > 0 ? rows / writer_busy.count() : 0;
+        report("ingest", static_cast<int>(rows), elapsed.count());
+        std::cout << std::fixed << std::setprecision(1) << "  file_mb=" << size / 1048576.0
+                  << " parse_threads=" << threads_
+                  << " parse_mb_per_sec=" << (parse_seconds > 0 ? size / 1048576.0 / parse_seconds : 0)
+                  << " parse_rows_per_sec=" << parse_rows_per_sec << " insert_rows_per_sec=" << insert_rows_per_sec
+                  << " writer_idle=" << std::setprecision(3) << writer_idle.count() << "s batches=" << batches
+                  << " skipped_lines=" << bad_lines
+                  << " bottleneck=" << (parse_rows_per_sec < insert_rows_per_sec ? "parse" : "insert") << std::endl;
+        printDbstatReport("ingest");
+    }
+
+    // Streams the table to --export_file.csv and .bin, first in table order
+    // and then, if a secondary index can provide one, in index order.
+    void exportAll() {
+        exportTable("export_csv", "", false);
+        exportTable("export_bin", "", true);
+        const std::string order = schema_.indexOrder();
+        if (order.empty()) {
+            std::cerr << "export: no plain, covering or expression index for an index-order export; pass --indexes."
+                      << std::endl;
+            return;
+        }
+        exportTable("export_csv_byindex", order, false);
+        exportTable("export_bin_byindex", order, true);
+    }
+
+    // One pass over the table, writing every row through an ExportWriter
+    // straight from sqlite3_column_*() pointers. CSV writes integers in
+    // decimal and text and BLOBs as-is, quoted only when they contain a comma,
+    // quote or line break. The binary format writes per column a type byte
+    // (SQLite's type code) and a varint: the zigzagged integer, or the length
+    // of the bytes that follow.
+    void exportTable(const std::string& name, const std::string& order, bool binary) {
+        const std::string path = export_file_ + (binary ? ".bin" : ".csv");
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            std::cerr << "Cannot create " << path << ": " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        sqlite3_stmt* stmt;
+        std::string sql = schema_.exportSql(order);
+        CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare export", db_);
+        const bool sorted = usesTempBTree(sql);
+        const int columns = sqlite3_column_count(stmt);
+
+        ExportWriter out(fd, export_buffer_);
+        uint64_t column_bytes = 0;
+        int rows = 0;
+        char scratch[24];
+        auto varint = [&](uint64_t v) {
+            int n = 0;
+            do {
+                scratch[n++] = static_cast<char>((v & 0x7f) | (v > 0x7f ? 0x80 : 0));
+                v >>= 7;
+            } while (v);
+            out.append(scratch, n);
+        };
+        auto start = std::chrono::high_resolution_clock::now();
+
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            for (int i = 0; i < columns; ++i) {
+                const int type = sqlite3_column_type(stmt, i);
+                if (type == SQLITE_INTEGER) {
+                    sqlite3_int64 v = sqlite3_column_int64(stmt, i);
+                    column_bytes += 8;
+                    if (binary) {
+                        out.put(static_cast<char>(type));
+                        varint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+                    } else {
+                        out.append(scratch, snprintf(scratch, sizeof(scratch), "%lld", static_cast<long long>(v)));
+                    }
+                } else {
+                    const char* p = static_cast<const char*>(type == SQLITE_TEXT ? sqlite3_column_text(stmt, i)
+                                                                                 : sqlite3_column_blob(stmt, i));
+                    const size_t n = sqlite3_column_bytes(stmt, i);
+                    column_bytes += n;
+                    if (binary) {
+                        out.put(static_cast<char>(type));
+                        varint(n);
+                        out.append(p, n);
+                    } else if (std::find_if(p, p + n, [](char c) {
+                                   return c == ',' || c == '"' || c == '\n' || c == '\r';
+                               }) == p + n) {
+                        out.append(p, n);
+                    } else {
+                        out.put('"');
+                        for (size_t j = 0; j < n; ++j) {
+                            if (p[j] == '"') out.put('"');
+                            out.put(p[j]);
+                        }
+                        out.put('"');
+                    }
+                }
+                if (!binary) out.put(i == columns - 1 ? '\n' : ',');
+            }
+            ++rows;
+        }
+        out.flush();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+
+        sqlite3_finalize(stmt);
+        close(fd);
+        report(name, rows, elapsed.count());
+        std::cout << std::fixed << std::setprecision(1) << "  file=" << path << " mb=" << out.bytes() / 1048576.0
+                  << " mb_per_sec=" << out.bytes() / 1048576.0 / elapsed.count()
+                  << " column_mb_per_sec=" << column_bytes / 1048576.0 / elapsed.count() << " writes=" << out.writes()
+                  << " order=" << (order.empty() ? "table" : order) << (sorted ? " (sorted)" : "") << std::endl;
+    }
+
+    // True if SQLite needs a temporary B-tree to sort |sql|'s results, i.e.
+    // no index provides the order.
+    bool usesTempBTree(const std::string& sql) {
+        sqlite3_stmt* stmt;
+        std::string plan_sql = "EXPLAIN QUERY PLAN " + sql;
+        CheckSqliteError(sqlite3_prepare_v2(db_, plan_sql.c_str(), -1, &stmt, nullptr), "prepare query plan", db_);
+        bool temp = false;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* detail = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+            if (detail && strstr(detail, "TEMP B-TREE")) temp = true;
+        }
+        sqlite3_finalize(stmt);
+        return temp;
+    }
+
+    // Large values through whole-value binds and column reads versus
+    // incremental BLOB I/O, once per --blob_sizes entry. Uses its own rowid
+    // table, blobs(id, data), since sqlite3_blob_open() needs a rowid. Each
+    // size writes --blob_mb MB (at most --num rows) both ways:
+    //   blob_bind_write     INSERT binding the whole value
+    //   blob_stream_write   INSERT of a zeroblob, then sqlite3_blob_write() in
+    //                       --blob_chunk pieces
+    // and reads as many random rows both ways:
+    //   blob_column_read    SELECT and sqlite3_column_blob()
+    //   blob_stream_read    sqlite3_blob_read() in --blob_chunk pieces
+    // Results are named like blob_bind_write@64KB; dbstat's overflow page
+    // count for the table is printed after the writes.
+    void blobIo() {
+        for (int size : blob_sizes_) {
+            const int rows = static_cast<int>(std::max<int64_t>(
+                1, std::min<int64_t>(num_entries_, (static_cast<int64_t>(blob_mb_) << 20) / size)));
+            const std::string label = size % (1 << 20) == 0 ? std::to_string(size >> 20) + "MB"
+                                      : size % 1024 == 0    ? std::to_string(size >> 10) + "KB"
+                                                            : std::to_string(size) + "B";
+            ValueGenerator values(size, compression_ratio_, 'b', rng_());
+            std::vector<char> buffer(size);
+            execAll({"DROP TABLE IF EXISTS blobs", "CREATE TABLE blobs (id INTEGER PRIMARY KEY, data BLOB)"});
+
+            sqlite3_stmt* insert;
+            CheckSqliteError(sqlite3_prepare_v2(db_, "INSERT INTO blobs (id, data) VALUES (?, ?)", -1, &insert, nullptr),
+                             "prepare blob insert", db_);
+            auto timed = [&](const std::string& name, auto body) {
+                auto start = std::chrono::high_resolution_clock::now();
+                body();
+                std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+                report(name + "@" + label, rows, elapsed.count());
+                std::cout << "  mb_per_sec=" << std::fixed << std::setprecision(1)
+                          << static_cast<double>(rows) * size / 1048576.0 / elapsed.count() << std::endl;
+            };
+
+            timed("blob_bind_write", [&] {
+                CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
+                for (int i = 0; i < rows; ++i) {
+                    sqlite3_bind_int64(insert, 1, i);
+                    sqlite3_bind_blob(insert, 2, values.next(), size, SQLITE_STATIC);
+                    if (sqlite3_step(insert) != SQLITE_DONE) CheckSqliteError(SQLITE_ERROR, "step blob insert", db_);
+                    sqlite3_reset(insert);
+                }
+                CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+            });
+
+            timed("blob_stream_write", [&] {
+                sqlite3_blob* blob = nullptr;
+                CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
+                for (int i = 0; i < rows; ++i) {
+                    sqlite3_int64 id = rows + i;
+                    sqlite3_bind_int64(insert, 1, id);
+                    sqlite3_bind_zeroblob(insert, 2, size);
+                    if (sqlite3_step(insert) != SQLITE_DONE) CheckSqliteError(SQLITE_ERROR, "step blob insert", db_);
+                    sqlite3_reset(insert);
+                    int rc = blob ? sqlite3_blob_reopen(blob, id)
+                                  : sqlite3_blob_open(db_, "main", "blobs", "data", id, 1, &blob);
+                    CheckSqliteError(rc, "open blob", db_);
+                    const char* data = values.next();
+                    for (int off = 0; off < size; off += blob_chunk_) {
+                        CheckSqliteError(sqlite3_blob_write(blob, data + off, std::min(blob_chunk_, size - off), off),
+                                         "write blob", db_);
+                    }
+                }
+                sqlite3_blob_close(blob);
+                CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+            });
+            sqlite3_finalize(insert);
+            printOverflowPages("blobs");
+
+            std::uniform_int_distribution<int64_t> dist(0, 2 * static_cast<int64_t>(rows) - 1);
+            volatile uint64_t checksum = 0;  // Keeps the reads from being optimized away.
+            sqlite3_stmt* select;
+            CheckSqliteError(sqlite3_prepare_v2(db_, "SELECT data FROM blobs WHERE id = ?", -1, &select, nullptr),
+                             "prepare blob select", db_);
+            timed("blob_column_read", [&] {
+                for (int i = 0; i < rows; ++i) {
+                    sqlite3_bind_int64(select, 1, dist(rng_));
+                    if (sqlite3_step(select) == SQLITE_ROW) {
+                        const char* p = static_cast<const char*>(sqlite3_column_blob(select, 0));
+                        int n = sqlite3_column_bytes(select, 0);
+                        if (n > 0) checksum += p[0] + p[n - 1];
+                    }
+                    sqlite3_reset(select);
+                }
+            });
+            sqlite3_finalize(select);
+
+            timed("blob_stream_read", [&] {
+                sqlite3_blob* blob = nullptr;
+                for (int i = 0; i < rows; ++i) {
+                    sqlite3_int64 id = dist(rng_);
+                    int rc = blob ? sqlite3_blob_reopen(blob, id)
+                                  : sqlite3_blob_open(db_, "main", "blobs", "data", id, 0, &blob);
+                    CheckSqliteError(rc, "open blob", db_);
+                    const int n = sqlite3_blob_bytes(blob);
+                    for (int off = 0; off < n; off += blob_chunk_) {
+                        int len = std::min(blob_chunk_, n - off);
+                        CheckSqliteError(sqlite3_blob_read(blob, buffer.data() + off, len, off), "read blob", db_);
+                    }
+                    if (n > 0) checksum += buffer[0] + buffer[n - 1];
+                }
+                sqlite3_blob_close(blob);
+            });
+        }
+        execAll({"DROP TABLE IF EXISTS blobs"});
+    }
+
+    // Reporting queries over a generated star schema, in its own tables: a
+    // sales fact table of --num rows, each with a --value_size payload so the
+    // scans cover as many pages as the OLTP table, and customers (--num / 100
+    // rows), products (--num / 1000) and stores (50) dimensions. Each query
+    // runs --analytics_reps times, first with only the primary keys (@noidx)
+    // and then with indexes on the fact table's foreign keys, channel and
+    // amount (@idx); both phases honour --mmap_fraction and --cache_fraction.
+    // ops/sec counts queries; the line below gives the mean latency, the
+    // result row count and the fact table rows covered per second.
+    void analytics() {
+        const int customers = std::max(1, num_entries_ / 100), products = std::max(10, num_entries_ / 1000),
+                  stores = 50;
+        execAll({"DROP TABLE IF EXISTS sales", "DROP TABLE IF EXISTS customers", "DROP TABLE IF EXISTS products",
+                 "DROP TABLE IF EXISTS stores",
+                 "CREATE TABLE customers (id INTEGER PRIMARY KEY, region INTEGER, segment INTEGER, name TEXT)",
+                 "CREATE TABLE products (id INTEGER PRIMARY KEY, category INTEGER, brand INTEGER, price REAL)",
+                 "CREATE TABLE stores (id INTEGER PRIMARY KEY, city INTEGER, country INTEGER)",
+                 "CREATE TABLE sales (id INTEGER PRIMARY KEY, customer_id INTEGER, product_id INTEGER, "
+                 "store_id INTEGER, day INTEGER, channel INTEGER, quantity INTEGER, amount REAL, payload BLOB)"});
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto insert_all = [this](const char* sql, int rows, const std::function<void(sqlite3_stmt*, int)>& bind) {
+            sqlite3_stmt* stmt;
+            CheckSqliteError(sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr), "prepare analytics insert", db_);
+            for (int i = 0; i < rows; ++i) {
+                bind(stmt, i);
+                if (sqlite3_step(stmt) != SQLITE_DONE) CheckSqliteError(SQLITE_ERROR, "step analytics insert", db_);
+                sqlite3_reset(stmt);
+            }
+            sqlite3_finalize(stmt);
+        };
+        std::uniform_int_distribution<int> customer(0, customers - 1), product(0, products - 1), store(0, stores - 1),
+            day(0, 364), channel(0, 3), quantity(1, 10), cents(100, 100000);
+        ValueGenerator values = makeValues('s', rng_());
+        CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
+        insert_all("INSERT INTO customers VALUES (?, ?, ?, ?)", customers, [](sqlite3_stmt* stmt, int i) {
+            std::string name = "customer" + std::to_string(i);
+            sqlite3_bind_int(stmt, 1, i);
+            sqlite3_bind_int(stmt, 2, i % 10);
+            sqlite3_bind_int(stmt, 3, (i / 10) % 5);
+            sqlite3_bind_text(stmt, 4, name.c_str(), -1, SQLITE_TRANSIENT);
+        });
+        insert_all("INSERT INTO products VALUES (?, ?, ?, ?)", products, [this, &cents](sqlite3_stmt* stmt, int i) {
+            sqlite3_bind_int(stmt, 1, i);
+            sqlite3_bind_int(stmt, 2, i % 20);
+            sqlite3_bind_int(stmt, 3, i % 200);
+            sqlite3_bind_double(stmt, 4, cents(rng_) / 100.0);
+        });
+        insert_all("INSERT INTO stores VALUES (?, ?, ?)", stores, [](sqlite3_stmt* stmt, int i) {
+            sqlite3_bind_int(stmt, 1, i);
+            sqlite3_bind_int(stmt, 2, i % 25);
+            sqlite3_bind_int(stmt, 3, i % 5);
+        });
+        insert_all("INSERT INTO sales VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)", num_entries_, [&](sqlite3_stmt* stmt, int i) {
+            ValueGenerator::Value payload = values.nextValue();
+            sqlite3_bind_int(stmt, 1, i);
+            sqlite3_bind_int(stmt, 2, customer(rng_));
+            sqlite3_bind_int(stmt, 3, product(rng_));
+            sqlite3_bind_int(stmt, 4, store(rng_));
+            sqlite3_bind_int(stmt, 5, day(rng_));
+            sqlite3_bind_int(stmt, 6, channel(rng_));
+            sqlite3_bind_int(stmt, 7, quantity(rng_));
+            sqlite3_bind_double(stmt, 8, cents(rng_) / 100.0);
+            sqlite3_bind_blob(stmt, 9, payload.data, payload.size, SQLITE_STATIC);
+        });
+        CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+        execAll({"ANALYZE"});
+        std::chrono::duration<double> load = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "  analytics load: sales=" << num_entries_ << " customers=" << customers
+                  << " products=" << products << " stores=" << stores << std::fixed << std::setprecision(2)
+                  << " time=" << load.count() << "s" << std::endl;
+        ResetVfsStats();
+
+        runSized([this] { analyticsQueries("@noidx"); });
+
+        start = std::chrono::high_resolution_clock::now();
+        execAll({"CREATE INDEX sales_customer ON sales (customer_id)",
+                 "CREATE INDEX sales_product ON sales (product_id)",
+                 "CREATE INDEX sales_channel ON sales (channel, amount)",
+                 "CREATE INDEX sales_amount ON sales (amount)", "ANALYZE"});
+        std::chrono::duration<double> index_time = std::chrono::high_resolution_clock::now() - start;
+        std::cout << "  analytics indexes: time=" << std::fixed << std::setprecision(2) << index_time.count() << "s"
+                  << std::endl;
+        ResetVfsStats();
+
+        runSized([this] { analyticsQueries("@idx"); });
+
+        execAll({"DROP TABLE sales", "DROP TABLE customers", "DROP TABLE products", "DROP TABLE stores",
+                 "DROP TABLE IF EXISTS sqlite_stat1"});
+    }
+
+    void analyticsQueries(const std::string& phase) {
+        static const std::vector<std::pair<std::string, std::string>> queries = {
+            {"count", "SELECT count(*) FROM sales"},
+            {"sum", "SELECT sum(quantity), sum(amount) FROM sales"},
+            {"groupby_low", "SELECT channel, count(*), sum(amount) FROM sales GROUP BY channel"},
+            {"groupby_high", "SELECT customer_id, count(*), sum(amount) FROM sales GROUP BY customer_id"},
+            {"topn", "SELECT id, amount FROM sales ORDER BY amount DESC LIMIT 100"},
+            {"join2",
+             "SELECT p.category, count(*), sum(s.amount) FROM sales s JOIN products p ON p.id = s.product_id "
+             "GROUP BY p.category"},
+            {"join3",
+             "SELECT c.region, p.category, count(*), sum(s.amount) FROM sales s "
+             "JOIN customers c ON c.id = s.customer_id JOIN products p ON p.id = s.product_id "
+             "GROUP BY c.region, p.category"},
+            {"join3_selective",
+             "SELECT st.city, count(*), sum(s.amount) FROM customers c JOIN sales s ON s.customer_id = c.id "
+             "JOIN stores st ON st.id = s.store_id WHERE c.region = 1 AND c.segment = 2 GROUP BY st.city"},
+        };
+        const int reps = std::max(1, analytics_reps_);
+        for (const auto& [name, sql] : queries) {
+            sqlite3_stmt* stmt;
+            CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare " + name, db_);
+            const bool sorted = usesTempBTree(sql);
+            int result_rows = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < reps; ++i) {
+                result_rows = 0;
+                while (sqlite3_step(stmt) == SQLITE_ROW) ++result_rows;
+                sqlite3_reset(stmt);
+            }
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            sqlite3_finalize(stmt);
+            report("analytics_" + name + phase, reps, elapsed.count());
+            std::cout << std::fixed << std::setprecision(2) << "  latency_ms=" << elapsed.count() * 1000.0 / reps
+                      << " result_rows=" << result_rows
+                      << " fact_rows_per_sec=" << static_cast<double>(num_entries_) * reps / elapsed.count()
+                      << (sorted ? " (temp b-tree)" : "") << std::endl;
+        }
+    }
+
+    // A transaction body for runTransactions(): runs transaction type |type|
+    // on its worker's connection and returns SQLITE_OK or the first error.
+    using TxnBody = std::function<int(int type, std::mt19937_64& rng)>;
+
+    // Runs --oltp_txns transactions, drawn from |types| (name, weight), once
+    // on one connection and once split across --threads connections, each in
+    // its own thread. |make_body| is called per connection and returns that
+    // worker's transaction body. Every transaction runs between BEGIN
+    // IMMEDIATE and COMMIT; on SQLITE_BUSY or SQLITE_LOCKED it is rolled back
+    // and retried from the start, up to --max_retries times with exponential
+    // backoff from --retry_backoff_us, after the connection's 1 s busy timeout.
+    // Results are named like tpcb@t4; ops/sec counts committed transactions.
+    void runTransactions(const std::string& name, const std::vector<std::pair<std::string, int>>& types,
+                         const std::function<TxnBody(sqlite3*)>& make_body) {
+        if (db_path_ == ":memory:") {
+            std::cerr << name << ": a :memory: database is private to one connection; use a shared one such as "
+                      << "--db_path=file:/bench?vfs=memdb or --vfs=ram." << std::endl;
+            return;
+        }
+        std::vector<int> thread_counts = {1};
+        if (threads_ > 1) thread_counts.push_back(threads_);
+        std::vector<int> weights;
+        for (const auto& type : types) weights.push_back(type.second);
+
+        for (int threads : thread_counts) {
+            const int per_thread = std::max(1, oltp_txns_ / threads);
+            std::vector<sqlite3*> conns;
+            for (int t = 0; t < threads; ++t) {
+                sqlite3* conn = openConnection();
+                applyPragmas(conn);
+                sqlite3_busy_timeout(conn, 1000);
+                conns.push_back(conn);
+            }
+            std::vector<std::vector<LatencyRecorder>> latencies(threads, std::vector<LatencyRecorder>(types.size()));
+            std::atomic<uint64_t> committed{0}, retries{0}, failed{0};
+            std::vector<std::thread> workers;
+            ResetVfsStats();
+            auto start = std::chrono::high_resolution_clock::now();
+
+            for (int t = 0; t < threads; ++t) {
+                uint64_t seed = rng_();
+                workers.emplace_back([&, t, seed] {
+                    sqlite3* conn = conns[t];
+                    TxnBody body = make_body(conn);
+                    std::mt19937_64 rng(seed);
+                    std::discrete_distribution<int> pick(weights.begin(), weights.end());
+                    for (int i = 0; i < per_thread; ++i) {
+                        const int type = pick(rng);
+                        auto txn_start = std::chrono::high_resolution_clock::now();
+                        for (int attempt = 0;; ++attempt) {
+                            int rc = sqlite3_exec(conn, "BEGIN IMMEDIATE", 0, 0, 0);
+                            if (rc == SQLITE_OK) rc = body(type, rng);
+                            if (rc == SQLITE_OK) rc = sqlite3_exec(conn, "COMMIT", 0, 0, 0);
+                            if (rc == SQLITE_OK) {
+                                ++committed;
+                                break;
+                            }
+                            if (!sqlite3_get_autocommit(conn)) sqlite3_exec(conn, "ROLLBACK", 0, 0, 0);
+                            const int primary = rc & 0xff;
+                            if ((primary != SQLITE_BUSY && primary != SQLITE_LOCKED) || attempt == max_retries_) {
+                                if (primary != SQLITE_BUSY && primary != SQLITE_LOCKED) {
+                                    std::cerr << name << ": " << types[type].first << " failed: " << sqlite3_errmsg(conn)
+                                              << std::endl;
+                                }
+                                ++failed;
+                                break;
+                            }
+                            ++retries;
+                            std::this_thread::sleep_for(std::chrono::microseconds(
+                                static_cast<int64_t>(retry_backoff_us_) << std::min(attempt, 16)));
+                        }
+                        latencies[t][type].add(std::chrono::high_resolution_clock::now() - txn_start);
+                    }
+                });
+            }
+            for (auto& w : workers) w.join();
+
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> elapsed = end - start;
+
+            for (sqlite3* conn : conns) sqlite3_close(conn);
+            report(name + "@t" + std::to_string(threads), static_cast<int>(committed), elapsed.count());
+            LatencyRecorder all;
+            for (size_t type = 0; type < types.size(); ++type) {
+                LatencyRecorder latency;
+                for (auto& l : latencies) latency.merge(l[type]);
+                all.merge(latency);
+                if (types.size() > 1) std::cout << "  latency " << types[type].first << " " << latency.summary() << std::endl;
+            }
+            std::cout << "  latency " << all.summary() << std::endl;
+            std::cout << "  threads=" << threads << " committed=" << committed << " retries=" << retries
+                      << " failed=" << failed << std::endl;
+        }
+    }
 
-// --- Benchmark Class ---
+    // TPC-B-like: the pgbench transaction on branches, tellers (10 per
+    // branch) and accounts (--num; one branch per 100000 accounts). Each
+    // transaction updates one account, teller and branch balance, reads the
+    // account back and appends a history row, touching four B-trees per
+    // commit.
+    void tpcb() {
+        const int accounts = num_entries_, branches = std::max(1, num_entries_ / 100000), tellers = branches * 10;
+        const std::string filler(84, 'f');
+        execAll({"DROP TABLE IF EXISTS tpcb_branches", "DROP TABLE IF EXISTS tpcb_tellers",
+                 "DROP TABLE IF EXISTS tpcb_accounts", "DROP TABLE IF EXISTS tpcb_history",
+                 "CREATE TABLE tpcb_branches (bid INTEGER PRIMARY KEY, bbalance INTEGER, filler TEXT)",
+                 "CREATE TABLE tpcb_tellers (tid INTEGER PRIMARY KEY, bid INTEGER, tbalance INTEGER, filler TEXT)",
+                 "CREATE TABLE tpcb_accounts (aid INTEGER PRIMARY KEY, bid INTEGER, abalance INTEGER, filler TEXT)",
+                 "CREATE TABLE tpcb_history (tid INTEGER, bid INTEGER, aid INTEGER, delta INTEGER, mtime INTEGER, "
+                 "filler TEXT)"});
+        {
+            TxnStatements load(db_);
+            const size_t branch = load.prepare("INSERT INTO tpcb_branches VALUES (?1, 0, ?2)");
+            const size_t teller = load.prepare("INSERT INTO tpcb_tellers VALUES (?1, ?2, 0, ?3)");
+            const size_t account = load.prepare("INSERT INTO tpcb_accounts VALUES (?1, ?2, 0, ?3)");
+            CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
+            for (int i = 0; i < branches; ++i) CheckSqliteError(load.exec(branch, i, filler.c_str()), "load", db_);
+            for (int i = 0; i < tellers; ++i) CheckSqliteError(load.exec(teller, i, i / 10, filler.c_str()), "load", db_);
+            for (int i = 0; i < accounts; ++i) {
+                CheckSqliteError(load.exec(account, i, i / 100000, filler.c_str()), "load", db_);
+            }
+            CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+        }
+        std::cout << "  tpcb load: branches=" << branches << " tellers=" << tellers << " accounts=" << accounts
+                  << std::endl;
 
-class Benchmark {
-private:
-    sqlite3* db_ = nullptr;
-    std::string db_path_;
-    int num_entries_;
-    int value_size_;
-    std::vector<std::string> pragmas_;
-    std::mt19937_64 rng_;
+        runTransactions("tpcb", {{"tpcb", 1}}, [=](sqlite3* conn) -> TxnBody {
+            auto s = std::make_shared<TxnStatements>(conn);
+            const size_t update_account = s->prepare("UPDATE tpcb_accounts SET abalance = abalance + ?1 WHERE aid = ?2");
+            const size_t select_account = s->prepare("SELECT abalance FROM tpcb_accounts WHERE aid = ?1");
+            const size_t update_teller = s->prepare("UPDATE tpcb_tellers SET tbalance = tbalance + ?1 WHERE tid = ?2");
+            const size_t update_branch = s->prepare("UPDATE tpcb_branches SET bbalance = bbalance + ?1 WHERE bid = ?2");
+            const size_t insert_history = s->prepare(
+                "INSERT INTO tpcb_history VALUES (?1, ?2, ?3, ?4, strftime('%s', 'now'), ?5)");
+            return [=](int, std::mt19937_64& rng) {
+                const int aid = std::uniform_int_distribution<int>(0, accounts - 1)(rng);
+                const int tid = std::uniform_int_distribution<int>(0, tellers - 1)(rng);
+                const int bid = tid / 10, delta = std::uniform_int_distribution<int>(-5000, 5000)(rng);
+                double balance;
+                int rc = s->exec(update_account, delta, aid);
+                if (rc == SQLITE_OK) rc = s->query(select_account, &balance, aid);
+                if (rc == SQLITE_OK) rc = s->exec(update_teller, delta, tid);
+                if (rc == SQLITE_OK) rc = s->exec(update_branch, delta, bid);
+                if (rc == SQLITE_OK) rc = s->exec(insert_history, tid, bid, aid, delta, "");
+                return rc;
+            };
+        });
+        execAll({"DROP TABLE tpcb_branches", "DROP TABLE tpcb_tellers", "DROP TABLE tpcb_accounts",
+                 "DROP TABLE tpcb_history"});
+    }
 
-    void openDatabase() {
-        if (db_path_ != ":memory:") {
-            unlink(db_path_.c_str());
+    // A simplified TPC-C: warehouses (one per 100000 --num), 10 districts
+    // each, up to 3000 customers per district, min(--num, 100000) items and
+    // a stock row per item and warehouse. The mix is half new-order (read
+    // the warehouse, district and customer; bump the district's next order
+    // id; insert the order, a new_order row and 5-15 order lines, each
+    // reading an item and updating its stock) and half payment (update the
+    // warehouse, district and customer totals; insert a history row).
+    // Latencies are printed per transaction type.
+    void tpcc() {
+        static const std::vector<std::string> tables = {"warehouse", "district", "customer", "item", "stock",
+                                                        "orders", "new_order", "order_line", "history"};
+        const int warehouses = std::max(1, num_entries_ / 100000), items = std::max(1, std::min(num_entries_, 100000)),
+                  customers = std::max(1, std::min(3000, num_entries_ / 10));
+        std::vector<std::string> ddl;
+        for (const auto& table : tables) ddl.push_back("DROP TABLE IF EXISTS tpcc_" + table);
+        ddl.insert(ddl.end(), {
+            "CREATE TABLE tpcc_warehouse (w_id INTEGER PRIMARY KEY, w_tax REAL, w_ytd REAL, w_name TEXT)",
+            "CREATE TABLE tpcc_district (d_w_id INTEGER, d_id INTEGER, d_tax REAL, d_ytd REAL, d_next_o_id INTEGER, "
+            "d_name TEXT, PRIMARY KEY (d_w_id, d_id))",
+            "CREATE TABLE tpcc_customer (c_w_id INTEGER, c_d_id INTEGER, c_id INTEGER, c_discount REAL, "
+            "c_balance REAL, c_ytd_payment REAL, c_payment_cnt INTEGER, c_data TEXT, "
+            "PRIMARY KEY (c_w_id, c_d_id, c_id))",
+            "CREATE TABLE tpcc_item (i_id INTEGER PRIMARY KEY, i_price REAL, i_name TEXT, i_data TEXT)",
+            "CREATE TABLE tpcc_stock (s_w_id INTEGER, s_i_id INTEGER, s_quantity INTEGER, s_ytd INTEGER, "
+            "s_order_cnt INTEGER, s_data TEXT, PRIMARY KEY (s_w_id, s_i_id))",
+            "CREATE TABLE tpcc_orders (o_w_id INTEGER, o_d_id INTEGER, o_id INTEGER, o_c_id INTEGER, "
+            "o_entry_d INTEGER, o_ol_cnt INTEGER, PRIMARY KEY (o_w_id, o_d_id, o_id))",
+            "CREATE TABLE tpcc_new_order (no_w_id INTEGER, no_d_id INTEGER, no_o_id INTEGER, "
+            "PRIMARY KEY (no_w_id, no_d_id, no_o_id))",
+            "CREATE TABLE tpcc_order_line (ol_w_id INTEGER, ol_d_id INTEGER, ol_o_id INTEGER, ol_number INTEGER, "
+            "ol_i_id INTEGER, ol_supply_w_id INTEGER, ol_quantity INTEGER, ol_amount REAL, "
+            "PRIMARY KEY (ol_w_id, ol_d_id, ol_o_id, ol_number))",
+            "CREATE TABLE tpcc_history (h_c_id INTEGER, h_c_d_id INTEGER, h_c_w_id INTEGER, h_d_id INTEGER, "
+            "h_w_id INTEGER, h_date INTEGER, h_amount REAL, h_data TEXT)"});
+        execAll(ddl);
+        {
+            const std::string customer_data(300, 'c'), item_data(50, 'i'), stock_data(50, 's');
+            std::uniform_real_distribution<double> tax(0, 0.2), discount(0, 0.5), price(1, 100);
+            TxnStatements load(db_);
+            const size_t warehouse = load.prepare("INSERT INTO tpcc_warehouse VALUES (?1, ?2, 300000, 'warehouse')");
+            const size_t district = load.prepare("INSERT INTO tpcc_district VALUES (?1, ?2, ?3, 30000, 1, 'district')");
+            const size_t customer = load.prepare("INSERT INTO tpcc_customer VALUES (?1, ?2, ?3, ?4, -10, 10, 1, ?5)");
+            const size_t item = load.prepare("INSERT INTO tpcc_item VALUES (?1, ?2, 'item', ?3)");
+            const size_t stock = load.prepare("INSERT INTO tpcc_stock VALUES (?1, ?2, ?3, 0, 0, ?4)");
+            CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
+            for (int i = 1; i <= items; ++i) {
+                CheckSqliteError(load.exec(item, i, price(rng_), item_data.c_str()), "load", db_);
+            }
+            for (int w = 1; w <= warehouses; ++w) {
+                CheckSqliteError(load.exec(warehouse, w, tax(rng_)), "load", db_);
+                for (int i = 1; i <= items; ++i) {
+                    CheckSqliteError(load.exec(stock, w, i, 10 + i % 91, stock_data.c_str()), "load", db_);
+                }
+                for (int d = 1; d <= 10; ++d) {
+                    CheckSqliteError(load.exec(district, w, d, tax(rng_)), "load", db_);
+                    for (int c = 1; c <= customers; ++c) {
+                        CheckSqliteError(load.exec(customer, w, d, c, discount(rng_), customer_data.c_str()), "load",
+                                         db_);
+                    }
+                }
+            }
+            CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
         }
+        std::cout << "  tpcc load: warehouses=" << warehouses << " districts=" << warehouses * 10
+                  << " customers=" << static_cast<int64_t>(warehouses) * 10 * customers << " items=" << items
+                  << std::endl;
 
-        int rc = sqlite3_open(db_path_.c_str(), &db_);
-        CheckSqliteError(rc, "Cannot open database: " + db_path_, db_);
+        runTransactions("tpcc", {{"new_order", 1}, {"payment", 1}}, [=](sqlite3* conn) -> TxnBody {
+            auto s = std::make_shared<TxnStatements>(conn);
+            const size_t select_warehouse = s->prepare("SELECT w_tax FROM tpcc_warehouse WHERE w_id = ?1");
+            const size_t select_district =
+                s->prepare("SELECT d_next_o_id FROM tpcc_district WHERE d_w_id = ?1 AND d_id = ?2");
+            const size_t bump_district = s->prepare(
+                "UPDATE tpcc_district SET d_next_o_id = d_next_o_id + 1 WHERE d_w_id = ?1 AND d_id = ?2");
+            const size_t select_customer = s->prepare(
+                "SELECT c_discount FROM tpcc_customer WHERE c_w_id = ?1 AND c_d_id = ?2 AND c_id = ?3");
+            const size_t insert_order = s->prepare("INSERT INTO tpcc_orders VALUES (?1, ?2, ?3, ?4, ?5, ?6)");
+            const size_t insert_new_order = s->prepare("INSERT INTO tpcc_new_order VALUES (?1, ?2, ?3)");
+            const size_t select_item = s->prepare("SELECT i_price FROM tpcc_item WHERE i_id = ?1");
+            const size_t select_stock =
+                s->prepare("SELECT s_quantity FROM tpcc_stock WHERE s_w_id = ?1 AND s_i_id = ?2");
+            const size_t update_stock = s->prepare(
+                "UPDATE tpcc_stock SET s_quantity = ?1, s_ytd = s_ytd + ?2, s_order_cnt = s_order_cnt + 1 "
+                "WHERE s_w_id = ?3 AND s_i_id = ?4");
+            const size_t insert_line =
+                s->prepare("INSERT INTO tpcc_order_line VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8)");
+            const size_t pay_warehouse = s->prepare("UPDATE tpcc_warehouse SET w_ytd = w_ytd + ?1 WHERE w_id = ?2");
+            const size_t pay_district =
+                s->prepare("UPDATE tpcc_district SET d_ytd = d_ytd + ?1 WHERE d_w_id = ?2 AND d_id = ?3");
+            const size_t pay_customer = s->prepare(
+                "UPDATE tpcc_customer SET c_balance = c_balance - ?1, c_ytd_payment = c_ytd_payment + ?1, "
+                "c_payment_cnt = c_payment_cnt + 1 WHERE c_w_id = ?2 AND c_d_id = ?3 AND c_id = ?4");
+            const size_t insert_history = s->prepare(
+                "INSERT INTO tpcc_history VALUES (?1, ?2, ?3, ?2, ?3, strftime('%s', 'now'), ?4, 'payment')");
+            return [=](int type, std::mt19937_64& rng) {
+                const int w = std::uniform_int_distribution<int>(1, warehouses)(rng);
+                const int d = std::uniform_int_distribution<int>(1, 10)(rng);
+                const int c = std::uniform_int_distribution<int>(1, customers)(rng);
+                int rc;
+                if (type == 1) {
+                    const double amount = std::uniform_int_distribution<int>(100, 500000)(rng) / 100.0;
+                    rc = s->exec(pay_warehouse, amount, w);
+                    if (rc == SQLITE_OK) rc = s->exec(pay_district, amount, w, d);
+                    if (rc == SQLITE_OK) rc = s->exec(pay_customer, amount, w, d, c);
+                    if (rc == SQLITE_OK) rc = s->exec(insert_history, c, d, w, amount);
+                    return rc;
+                }
+                const int lines = std::uniform_int_distribution<int>(5, 15)(rng);
+                double tax, order_id, discount;
+                rc = s->query(select_warehouse, &tax, w);
+                if (rc == SQLITE_OK) rc = s->query(select_district, &order_id, w, d);
+                if (rc == SQLITE_OK) rc = s->exec(bump_district, w, d);
+                if (rc == SQLITE_OK) rc = s->query(select_customer, &discount, w, d, c);
+                const int64_t o = static_cast<int64_t>(order_id);
+                if (rc == SQLITE_OK) rc = s->exec(insert_order, w, d, o, c, static_cast<int64_t>(time(nullptr)), lines);
+                if (rc == SQLITE_OK) rc = s->exec(insert_new_order, w, d, o);
+                for (int n = 1; n <= lines && rc == SQLITE_OK; ++n) {
+                    const int i = std::uniform_int_distribution<int>(1, items)(rng);
+                    const int quantity = std::uniform_int_distribution<int>(1, 10)(rng);
+                    double price, stock;
+                    rc = s->query(select_item, &price, i);
+                    if (rc == SQLITE_OK) rc = s->query(select_stock, &stock, w, i);
+                    const int left = stock - quantity >= 10 ? static_cast<int>(stock) - quantity
+                                                            : static_cast<int>(stock) - quantity + 91;
+                    if (rc == SQLITE_OK) rc = s->exec(update_stock, left, quantity, w, i);
+                    if (rc == SQLITE_OK) {
+                        rc = s->exec(insert_line, w, d, o, n, i, w, quantity,
+                                     quantity * price * (1 + tax) * (1 - discount));
+                    }
+                }
+                return rc;
+            };
+        });
+        std::vector<std::string> drop;
+        for (const auto& table : tables) drop.push_back("DROP TABLE tpcc_" + table);
+        execAll(drop);
+    }
 
-        for (const auto& pragma_str : pragmas_) {
-            char* err_msg = nullptr;
-            std::string full_pragma = "PRAGMA " + pragma_str + ";";
-            rc = sqlite3_exec(db_, full_pragma.c_str(), 0, 0, &err_msg);
-            if (rc != SQLITE_OK) {
-                std::cerr << "Failed to execute PRAGMA: " << full_pragma << std::endl;
-                std::cerr << "  Error: " << err_msg << std::endl;
-                sqlite3_free(err_msg);
-                sqlite3_close(db_);
-                exit(EXIT_FAILURE);
+    // Large sorts and temporary B-trees with no index to help (see
+    // Schema::sortSql): ORDER BY and DISTINCT on substr(hex(key), -4) ||
+    // hex(key), GROUP BY on its first part, and CREATE INDEX on the whole
+    // expression, once for every combination of --sort_temp_store,
+    // --sort_cache_mb and --sort_threads (PRAGMA temp_store, cache_size and
+    // threads). Results are named like sort_orderby@file@cache2mb@t0, and
+    // ops/sec counts table rows. The spill shows in the [tempio] line when
+    // --vfs includes that layer; the line below gives the peak SQLite heap,
+    // which is where temp_store=MEMORY keeps the same data, and the worker
+    // threads SQLite actually allowed.
+    void sort() {
+        if (std::none_of(VfsLayers().begin(), VfsLayers().end(),
+                         [](const std::unique_ptr<ShimVfs>& layer) { return layer->name() == "tempio"; })) {
+            std::cerr << "sort: temp file I/O is not reported; add the tempio layer, e.g. --vfs=tempio." << std::endl;
+        }
+        const int rows = static_cast<int>(countRows());
+        const sqlite3_int64 saved_temp_store = pragmaInt("temp_store"), saved_cache = pragmaInt("cache_size"),
+                            saved_threads = pragmaInt("threads");
+        for (const auto& temp_store : sort_temp_stores_) {
+            for (int cache_mb : sort_cache_mb_) {
+                for (int threads : sort_threads_) {
+                    execAll({"PRAGMA temp_store = " + temp_store,
+                             "PRAGMA cache_size = -" + std::to_string(static_cast<int64_t>(cache_mb) * 1024),
+                             "PRAGMA threads = " + std::to_string(threads)});
+                    const std::string suffix = "@" + temp_store + "@cache" + std::to_string(cache_mb) + "mb@t" +
+                                               std::to_string(threads);
+                    for (const std::string& kind :
+                         std::vector<std::string>{"orderby", "distinct", "groupby", "createindex"}) {
+                        const std::string sql = schema_.sortSql(kind);
+                        sqlite3_stmt* stmt;
+                        CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare " + sql,
+                                         db_);
+                        sqlite3_db_release_memory(db_);
+                        sqlite3_int64 heap, heap_peak;
+                        sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &heap, &heap_peak, 1);
+                        ResetVfsStats();
+                        int result_rows = 0;
+                        auto start = std::chrono::high_resolution_clock::now();
+                        int rc;
+                        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) ++result_rows;
+                        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+                        if (rc != SQLITE_DONE) CheckSqliteError(rc, "step " + sql, db_);
+                        sqlite3_finalize(stmt);
+                        if (kind == "createindex") execAll({"DROP INDEX test_sort_idx"});
+                        sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &heap, &heap_peak, 0);
+                        report("sort_" + kind + suffix, rows, elapsed.count());
+                        std::cout << std::fixed << std::setprecision(1) << "  result_rows=" << result_rows
+                                  << " heap_peak_mb=" << heap_peak / 1048576.0
+                                  << " threads=" << pragmaInt("threads") << std::endl;
+                    }
+                }
             }
         }
+        execAll({"PRAGMA temp_store = " + std::to_string(saved_temp_store),
+                 "PRAGMA cache_size = " + std::to_string(saved_cache),
+                 "PRAGMA threads = " + std::to_string(saved_threads)});
+    }
 
-        const char* create_sql = "CREATE TABLE IF NOT EXISTS test (key INTEGER PRIMARY KEY, value BLOB);";
-        char* err_msg = nullptr;
-        rc = sqlite3_exec(db_, create_sql, 0, 0, &err_msg);
-        if (rc != SQLITE_OK) {
-            std::cerr << "Failed to create table." << std::endl;
-            std::cerr << "  Error: " << err_msg << std::endl;
-            sqlite3_free(err_msg);
-            sqlite3_close(db_);
-            exit(EXIT_FAILURE);
+    // Full-text search with FTS5 over a generated corpus (FtsCorpus: --num
+    // documents of --fts_doc_words words from a --fts_vocab word vocabulary
+    // with Zipf exponent --fts_zipf), in its own tables:
+    //   fts_ingest@batchN      the corpus inserted into a fresh fts_docs
+    //                          table, committing every N documents, once per
+    //                          --fts_batch entry; the last table is kept
+    //   queries@ingested       the query set below on the unmerged index
+    //   fts_merge              'merge' steps of --fts_merge_pages pages until
+    //                          no work is left (ops/sec counts steps)
+    //   fts_optimize           'optimize' into a single segment
+    //   queries@optimized      the query set again
+    //   fts_ingest_concurrent  --num / 10 more documents while another
+    //                          connection runs term queries, through
+    //                          withForegroundReads (use WAL)
+    // The query set runs --fts_queries of each: fts_term (one word), fts_phrase
+    // (a two-word phrase sampled from the corpus), fts_prefix (three letters
+    // and *) and fts_boolean ("a AND (b OR c) NOT d"), each ranked by bm25 and
+    // limited to 20 hits, and like_term, the unranked LIKE '%word%' scan of a
+    // plain copy of the documents an app without FTS would run (LIMIT 20, so
+    // common words stop early), with fewer queries since each is a full scan.
+    void fts() {
+        const FtsCorpus corpus(fts_vocab_, fts_zipf_, fts_doc_words_, rng_());
+        const uint64_t corpus_seed = rng_();
+        std::vector<std::string> phrases;
+        for (size_t b = 0; b < fts_batches_.size(); ++b) {
+            const int batch = fts_batches_[b];
+            execAll({"DROP TABLE IF EXISTS fts_docs", "CREATE VIRTUAL TABLE fts_docs USING fts5(body)"});
+            std::mt19937_64 rng(corpus_seed);
+            uint64_t bytes = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            ftsInsert(corpus, rng, num_entries_, batch, &bytes, b + 1 == fts_batches_.size() ? &phrases : nullptr);
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            report("fts_ingest@batch" + std::to_string(batch), num_entries_, elapsed.count());
+            std::cout << std::fixed << std::setprecision(1) << "  text_mb=" << bytes / 1048576.0
+                      << " mb_per_sec=" << bytes / 1048576.0 / elapsed.count() << " " << ftsIndexSize() << std::endl;
         }
-    }
+        execAll({"DROP TABLE IF EXISTS fts_plain", "CREATE TABLE fts_plain (id INTEGER PRIMARY KEY, body TEXT)",
+                 "INSERT INTO fts_plain (id, body) SELECT rowid, body FROM fts_docs"});
+        ResetVfsStats();
 
-    void closeDatabase() {
-        if (db_) {
-            sqlite3_close(db_);
-            db_ = nullptr;
+        ftsQueries(corpus, phrases, "@ingested");
+
+        sqlite3_stmt* merge;
+        CheckSqliteError(
+            sqlite3_prepare_v2(db_, "INSERT INTO fts_docs (fts_docs, rank) VALUES ('merge', ?)", -1, &merge, nullptr),
+            "prepare merge", db_);
+        sqlite3_bind_int(merge, 1, fts_merge_pages_);
+        int steps = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (;;) {
+            const int before = sqlite3_total_changes(db_);
+            if (sqlite3_step(merge) != SQLITE_DONE) CheckSqliteError(SQLITE_ERROR, "merge", db_);
+            sqlite3_reset(merge);
+            ++steps;
+            if (sqlite3_total_changes(db_) - before < 2) break;  // No work was left, per the FTS5 docs.
         }
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+        sqlite3_finalize(merge);
+        report("fts_merge", steps, elapsed.count());
+        std::cout << "  pages_per_step=" << fts_merge_pages_ << " " << ftsIndexSize() << std::endl;
+
+        start = std::chrono::high_resolution_clock::now();
+        execAll({"INSERT INTO fts_docs (fts_docs) VALUES ('optimize')"});
+        elapsed = std::chrono::high_resolution_clock::now() - start;
+        report("fts_optimize", 1, elapsed.count());
+        std::cout << "  " << ftsIndexSize() << std::endl;
+
+        ftsQueries(corpus, phrases, "@optimized");
+
+        auto bind_term = [&corpus](sqlite3_stmt* stmt, std::mt19937_64& rng) {
+            sqlite3_bind_text(stmt, 1, corpus.word(rng).c_str(), -1, SQLITE_TRANSIENT);
+        };
+        const int docs = std::max(1, num_entries_ / 10);
+        std::mt19937_64 rng(corpus_seed + 2);
+        uint64_t bytes = 0;
+        const double ingest = withForegroundReads(kFtsMatchSql, bind_term, fts_queries_, [&] {
+            ftsInsert(corpus, rng, docs, fts_batches_.back(), &bytes, nullptr);
+        });
+        report("fts_ingest_concurrent", docs, ingest);
+        execAll({"DROP TABLE fts_docs", "DROP TABLE fts_plain"});
     }
 
-    void report(const std::string& name, int num_ops, double duration_sec) {
-        double ops_per_sec = num_ops / duration_sec;
-        std::cout << std::left << std::setw(20) << name << ": "
-                  << std::fixed << std::setprecision(2) << ops_per_sec
-                  << " ops/sec (" << num_ops << " ops in " << duration_sec << "s)" << std::endl;
+    static constexpr const char* kFtsMatchSql =
+        "SELECT rowid FROM fts_docs WHERE fts_docs MATCH ? ORDER BY rank LIMIT 20";
+
+    // Inserts |docs| corpus documents into fts_docs, committing every |batch|.
+    // Adds the document bytes to |*bytes|, and with |phrases|, samples up to
+    // 1000 two-word phrases from the documents for phrase queries.
+    void ftsInsert(const FtsCorpus& corpus, std::mt19937_64& rng, int docs, int batch, uint64_t* bytes,
+                   std::vector<std::string>* phrases) {
+        sqlite3_stmt* stmt;
+        CheckSqliteError(sqlite3_prepare_v2(db_, "INSERT INTO fts_docs (body) VALUES (?)", -1, &stmt, nullptr),
+                         "prepare fts insert", db_);
+        const int sample_every = std::max(1, docs / 1000);
+        batch = std::max(1, batch);
+        for (int i = 0; i < docs; ++i) {
+            if (i % batch == 0) CheckSqliteError(sqlite3_exec(db_, "BEGIN", 0, 0, 0), "begin transaction", db_);
+            const std::string doc = corpus.document(rng);
+            *bytes += doc.size();
+            if (phrases && i % sample_every == 0) {
+                const size_t space = doc.find(' ');
+                if (space != std::string::npos) phrases->push_back(doc.substr(0, doc.find(' ', space + 1)));
+            }
+            sqlite3_bind_text(stmt, 1, doc.data(), static_cast<int>(doc.size()), SQLITE_STATIC);
+            if (sqlite3_step(stmt) != SQLITE_DONE) CheckSqliteError(SQLITE_ERROR, "step fts insert", db_);
+            sqlite3_reset(stmt);
+            if (i % batch == batch - 1 || i == docs - 1) {
+                CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+            }
+        }
+        sqlite3_finalize(stmt);
     }
 
-public:
-    Benchmark(std::string path, int num, int val_size, std::string pragma_str)
-        : db_path_(std::move(path)),
-          num_entries_(num),
-          value_size_(val_size) {
-        
-        if (!pragma_str.empty()) {
-            pragmas_ = split(pragma_str, ',');
+    void ftsQueries(const FtsCorpus& corpus, const std::vector<std::string>& phrases, const std::string& suffix) {
+        std::mt19937_64 rng(phrases.size());
+        auto term = [&] { return corpus.word(rng); };
+        const std::vector<std::pair<std::string, std::function<std::string()>>> kinds = {
+            {"fts_term", term},
+            {"fts_phrase",
+             [&] {
+                 return "\"" + (phrases.empty() ? term() : phrases[rng() % phrases.size()]) + "\"";
+             }},
+            {"fts_prefix", [&] { return term().substr(0, 3) + "*"; }},
+            {"fts_boolean", [&] { return term() + " AND (" + term() + " OR " + term() + ") NOT " + term(); }},
+            {"like_term", [&] { return "%" + term() + "%"; }},
+        };
+        for (const auto& [name, make_query] : kinds) {
+            const bool like = name == "like_term";
+            const int queries = like ? std::max(5, fts_queries_ / 50) : std::max(1, fts_queries_);
+            sqlite3_stmt* stmt;
+            const char* sql = like ? "SELECT id FROM fts_plain WHERE body LIKE ? LIMIT 20" : kFtsMatchSql;
+            CheckSqliteError(sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr), "prepare " + name, db_);
+            LatencyRecorder latency;
+            uint64_t hits = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < queries; ++i) {
+                const std::string query = make_query();
+                auto op_start = std::chrono::high_resolution_clock::now();
+                sqlite3_bind_text(stmt, 1, query.c_str(), -1, SQLITE_TRANSIENT);
+                int rc;
+                while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) ++hits;
+                if (rc != SQLITE_DONE) CheckSqliteError(rc, name + " " + query, db_);
+                sqlite3_reset(stmt);
+                latency.add(std::chrono::high_resolution_clock::now() - op_start);
+            }
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            sqlite3_finalize(stmt);
+            report(name + suffix, queries, elapsed.count());
+            std::cout << "  latency " << latency.summary() << " avg_hits=" << std::fixed << std::setprecision(1)
+                      << static_cast<double>(hits) / queries << std::endl;
         }
-        std::random_device rd;
-        rng_.seed(rd());
     }
 
-    ~Benchmark() {
-        closeDatabase();
+    // fts_docs' index size: rows and MB in its %_data shadow table, where
+    // more rows for the same data mean more segments to search.
+    std::string ftsIndexSize() {
+        sqlite3_stmt* stmt;
+        CheckSqliteError(sqlite3_prepare_v2(db_, "SELECT count(*), total(length(block)) FROM fts_docs_data", -1, &stmt,
+                                            nullptr),
+                         "prepare fts size", db_);
+        std::ostringstream out;
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            out << "index_rows=" << sqlite3_column_int64(stmt, 0) << " index_mb=" << std::fixed
+                << std::setprecision(1) << sqlite3_column_double(stmt, 1) / 1048576.0;
+        }
+        sqlite3_finalize(stmt);
+        return out.str();
     }
 
-    void run(const std::vector<std::string>& benchmarks_to_run) {
-        std::cout << "--- Benchmark Configuration ---" << std::endl;
-        std::cout << "Database path: " << db_path_ << std::endl;
-        std::cout << "Entries:       " << num_entries_ << std::endl;
-        std::cout << "Value Size:    " << value_size_ << " bytes" << std::endl;
-        std::cout << "PRAGMAs:       ";
-        if (pragmas_.empty()) {
-            std::cout << "[defaults]";
-        } else {
-            for(size_t i = 0; i < pragmas_.size(); ++i) {
-                std::cout << pragmas_[i] << (i == pragmas_.size() - 1 ? "" : ", ");
+    // A JSON document store in its own tables, next to the same data stored
+    // relationally. Each of --num documents looks like
+    //   {"id":1,"status":"s3","score":123,"user":{"name":"u...","country":"c7"},
+    //    "tags":[...],"f0":...,"n":{"f0":...,"n":{...}}}
+    // with --json_fields fields per object and --json_depth nested "n"
+    // levels. json_docs keeps whole documents as TEXT or, with
+    // --json_format=jsonb (SQLite 3.45+), JSONB blobs. json_rel holds id,
+    // status, score, name and country as columns and the rest as JSON text.
+    // Results end in @text or @jsonb:
+    //   json_insert / rel_insert        loading each table
+    //   json_filter_scan / rel_filter_scan
+    //                                   count(*) of one status, no index
+    //   json_exprindex_create / json_exprindex_lookup
+    //                                   an index on json_extract(doc,'$.score')
+    //                                   and point queries through it (scores
+    //                                   are in [0, --num), about one row each)
+    //   json_gencol_create / json_gencol_lookup
+    //                                   a VIRTUAL generated column for
+    //                                   $.user.country, its index and count(*)s
+    //   rel_score_lookup / rel_country_lookup
+    //                                   the same queries on indexed columns
+    //   json_fetch_path / json_fetch_deep / rel_fetch
+    //                                   $.user.name (or the name column) and the
+    //                                   deepest field by primary key
+    //   json_set_update / rel_update    --num / 10 score updates via json_set
+    //                                   versus a column update
+    void jsonDocs() {
+        bool jsonb = json_format_ == "jsonb";
+        if (jsonb) {
+            sqlite3_stmt* probe;
+            if (sqlite3_prepare_v2(db_, "SELECT jsonb('{}')", -1, &probe, nullptr) != SQLITE_OK) {
+                std::cout << "  jsonb unavailable (needs SQLite 3.45+, this is " << sqlite3_libversion()
+                          << "); storing documents as text" << std::endl;
+                jsonb = false;
             }
+            sqlite3_finalize(probe);
         }
-        std::cout << "\n-----------------------------" << std::endl;
+        const std::string suffix = jsonb ? "@jsonb" : "@text";
+        const std::string fn = jsonb ? "jsonb" : "json";
+        std::string deep_path = "$";
+        for (int d = 0; d < json_depth_; ++d) deep_path += ".n";
+        deep_path += ".f0";
 
-        for (const auto& bench_name : benchmarks_to_run) {
-            openDatabase();
-            // --- MODIFIED: Added call to readseq benchmark ---
-            if (bench_name == "fillseq") fillSequential();
-            else if (bench_name == "fillrandom") fillRandom();
-            else if (bench_name == "readrandom") {
-                fillRandom(true);
-                readRandom();
-            } else if (bench_name == "readseq") {
-                fillRandom(true);
-                readSequential();
-            } else if (bench_name == "readwrite") {
-                fillRandom(true);
-                readWrite();
-            } else {
-                std::cerr << "Unknown benchmark: " << bench_name << std::endl;
+        execAll({"DROP TABLE IF EXISTS json_docs", "DROP TABLE IF EXISTS json_rel",
+                 std::string("CREATE TABLE json_docs (id INTEGER PRIMARY KEY, doc ") + (jsonb ? "BLOB)" : "TEXT)"),
+                 "CREATE TABLE json_rel (id INTEGER PRIMARY KEY, status TEXT, score INTEGER, name TEXT, "
+                 "country TEXT, extra TEXT)"});
+
+        const uint64_t seed = rng_();
+        auto load = [&](const std::string& name, const std::string& sql, bool relational) {
+            sqlite3_stmt* stmt;
+            CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare " + sql, db_);
+            std::mt19937_64 rng(seed);
+            uint64_t bytes = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
+            for (int i = 0; i < num_entries_; ++i) {
+                JsonDoc doc = makeJsonDoc(rng, i);
+                sqlite3_bind_int(stmt, 1, i);
+                if (relational) {
+                    sqlite3_bind_text(stmt, 2, doc.status.c_str(), -1, SQLITE_STATIC);
+                    sqlite3_bind_int(stmt, 3, doc.score);
+                    sqlite3_bind_text(stmt, 4, doc.name.c_str(), -1, SQLITE_STATIC);
+                    sqlite3_bind_text(stmt, 5, doc.country.c_str(), -1, SQLITE_STATIC);
+                    sqlite3_bind_text(stmt, 6, doc.extra.c_str(), -1, SQLITE_STATIC);
+                } else {
+                    sqlite3_bind_text(stmt, 2, doc.json.c_str(), -1, SQLITE_STATIC);
+                }
+                bytes += relational ? doc.extra.size() : doc.json.size();
+                if (sqlite3_step(stmt) != SQLITE_DONE) CheckSqliteError(SQLITE_ERROR, "step " + sql, db_);
+                sqlite3_reset(stmt);
             }
-            closeDatabase();
-        }
+            CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            sqlite3_finalize(stmt);
+            report(name + suffix, num_entries_, elapsed.count());
+            std::cout << "  avg_json_bytes=" << bytes / std::max(1, num_entries_) << std::endl;
+        };
+        load("json_insert", "INSERT INTO json_docs VALUES (?1, " + fn + "(?2))", false);
+        load("rel_insert", "INSERT INTO json_rel VALUES (?1, ?2, ?3, ?4, ?5, ?6)", true);
+
+        // Runs |sql| |count| times, binding parameters with |bind|, and reports
+        // queries per second, latency and rows returned.
+        auto queries = [&](const std::string& name, const std::string& sql, int count,
+                           const std::function<void(sqlite3_stmt*, std::mt19937_64&)>& bind) {
+            sqlite3_stmt* stmt;
+            CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare " + sql, db_);
+            std::mt19937_64 rng(seed + 1);
+            LatencyRecorder latency;
+            uint64_t rows = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < count; ++i) {
+                auto op_start = std::chrono::high_resolution_clock::now();
+                bind(stmt, rng);
+                int rc;
+                while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) ++rows;
+                if (rc != SQLITE_DONE) CheckSqliteError(rc, "step " + sql, db_);
+                sqlite3_reset(stmt);
+                latency.add(std::chrono::high_resolution_clock::now() - op_start);
+            }
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            sqlite3_finalize(stmt);
+            report(name + suffix, count, elapsed.count());
+            std::cout << "  latency " << latency.summary() << " rows=" << rows << std::endl;
+        };
+        auto timed_ddl = [&](const std::string& name, const std::vector<std::string>& ddl) {
+            auto start = std::chrono::high_resolution_clock::now();
+            execAll(ddl);
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            report(name + suffix, num_entries_, elapsed.count());
+        };
+        auto bind_status = [](sqlite3_stmt* stmt, std::mt19937_64& rng) {
+            sqlite3_bind_text(stmt, 1, ("s" + std::to_string(rng() % kJsonStatuses)).c_str(), -1, SQLITE_TRANSIENT);
+        };
+        auto bind_score = [this](sqlite3_stmt* stmt, std::mt19937_64& rng) {
+            sqlite3_bind_int(stmt, 1, static_cast<int>(rng() % jsonScores()));
+        };
+        auto bind_country = [](sqlite3_stmt* stmt, std::mt19937_64& rng) {
+            sqlite3_bind_text(stmt, 1, ("c" + std::to_string(rng() % kJsonCountries)).c_str(), -1, SQLITE_TRANSIENT);
+        };
+        auto bind_id = [this](sqlite3_stmt* stmt, std::mt19937_64& rng) {
+            sqlite3_bind_int64(stmt, 1, static_cast<int64_t>(rng() % std::max(1, num_entries_)));
+        };
+        const int lookups = std::max(1, json_queries_), scans = std::max(5, json_queries_ / 100);
+
+        queries("json_filter_scan", "SELECT count(*) FROM json_docs WHERE json_extract(doc, '$.status') = ?", scans,
+                bind_status);
+        queries("rel_filter_scan", "SELECT count(*) FROM json_rel WHERE status = ?", scans, bind_status);
+
+        timed_ddl("json_exprindex_create", {"CREATE INDEX json_docs_score ON json_docs (json_extract(doc, '$.score'))"});
+        queries("json_exprindex_lookup", "SELECT id FROM json_docs WHERE json_extract(doc, '$.score') = ?", lookups,
+                bind_score);
+        timed_ddl("json_gencol_create",
+                  {"ALTER TABLE json_docs ADD COLUMN country TEXT GENERATED ALWAYS AS "
+                   "(json_extract(doc, '$.user.country')) VIRTUAL",
+                   "CREATE INDEX json_docs_country ON json_docs (country)"});
+        queries("json_gencol_lookup", "SELECT count(*) FROM json_docs WHERE country = ?", lookups, bind_country);
+
+        execAll({"CREATE INDEX json_rel_score ON json_rel (score)", "CREATE INDEX json_rel_country ON json_rel (country)"});
+        queries("rel_score_lookup", "SELECT id FROM json_rel WHERE score = ?", lookups, bind_score);
+        queries("rel_country_lookup", "SELECT count(*) FROM json_rel WHERE country = ?", lookups, bind_country);
+
+        queries("json_fetch_path", "SELECT json_extract(doc, '$.user.name') FROM json_docs WHERE id = ?", lookups,
+                bind_id);
+        queries("json_fetch_deep", "SELECT json_extract(doc, '" + deep_path + "') FROM json_docs WHERE id = ?",
+                lookups, bind_id);
+        queries("rel_fetch", "SELECT name FROM json_rel WHERE id = ?", lookups, bind_id);
+
+        const int updates = std::max(1, num_entries_ / 10);
+        auto update = [&](const std::string& name, const std::string& sql) {
+            sqlite3_stmt* stmt;
+            CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare " + sql, db_);
+            std::mt19937_64 rng(seed + 2);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < updates; ++i) {
+                if (i % 1000 == 0) CheckSqliteError(sqlite3_exec(db_, "BEGIN", 0, 0, 0), "begin transaction", db_);
+                sqlite3_bind_int(stmt, 1, static_cast<int>(rng() % jsonScores()));
+                sqlite3_bind_int64(stmt, 2, static_cast<int64_t>(rng() % std::max(1, num_entries_)));
+                if (sqlite3_step(stmt) != SQLITE_DONE) CheckSqliteError(SQLITE_ERROR, "step " + sql, db_);
+                sqlite3_reset(stmt);
+                if (i % 1000 == 999 || i == updates - 1) {
+                    CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+                }
+            }
+            std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+            sqlite3_finalize(stmt);
+            report(name + suffix, updates, elapsed.count());
+        };
+        update("json_set_update", "UPDATE json_docs SET doc = " + fn + "_set(doc, '$.score', ?1) WHERE id = ?2");
+        update("rel_update", "UPDATE json_rel SET score = ?1 WHERE id = ?2");
+
+        execAll({"DROP TABLE json_docs", "DROP TABLE json_rel"});
     }
 
-    void fillSequential(bool silent = false) {
+    static constexpr int kJsonStatuses = 5;
+    static constexpr int kJsonCountries = 50;
+
+    // Scores range over [0, --num), so each one is shared by about one
+    // document and a random score lookup usually finds a row.
+    int jsonScores() const { return std::max(1, num_entries_); }
+
+    struct JsonDoc {
+        std::string json;  // The whole document.
+        std::string status, name, country;
+        int score;
+        std::string extra;  // The document minus the fields above, for json_rel.
+    };
+
+    JsonDoc makeJsonDoc(std::mt19937_64& rng, int id) const {
+        auto text = [&rng](char prefix) {
+            std::string s(12, prefix);
+            for (size_t i = 1; i < s.size(); ++i) s[i] = static_cast<char>('a' + rng() % 26);
+            return s;
+        };
+        // |fields| scalars plus, below the last level, a nested "n" object.
+        std::function<std::string(int)> object = [&](int depth) {
+            std::string out = "{";
+            for (int f = 0; f < json_fields_; ++f) {
+                out += (f ? ",\"f" : "\"f") + std::to_string(f) + "\":";
+                out += f % 2 ? "\"" + text('v') + "\"" : std::to_string(rng() % 100000);
+            }
+            if (depth > 0) out += std::string(json_fields_ ? "," : "") + "\"n\":" + object(depth - 1);
+            return out + "}";
+        };
+        JsonDoc doc;
+        doc.status = "s" + std::to_string(rng() % kJsonStatuses);
+        doc.score = static_cast<int>(rng() % jsonScores());
+        doc.name = text('u');
+        doc.country = "c" + std::to_string(rng() % kJsonCountries);
+        std::string rest = "\"tags\":[\"" + text('t') + "\",\"" + text('t') + "\",\"" + text('t') + "\"]";
+        const std::string nested = object(json_depth_);
+        if (nested.size() > 2) rest += "," + nested.substr(1, nested.size() - 2);
+        doc.extra = "{" + rest + "}";
+        doc.json = "{\"id\":" + std::to_string(id) + ",\"status\":\"" + doc.status + "\",\"score\":" +
+                   std::to_string(doc.score) + ",\"user\":{\"name\":\"" + doc.name + "\",\"country\":\"" +
+                   doc.country + "\"}," + rest + "}";
+        return doc;
+    }
+
+    // Prints how many of |table|'s pages are B-tree leaves and overflow pages,
+    // from the dbstat virtual table when SQLite was built with it.
+    void printOverflowPages(const std::string& table) {
         sqlite3_stmt* stmt;
-        const char* sql = "INSERT INTO test (key, value) VALUES (?, ?)";
-        CheckSqliteError(sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr), "prepare insert", db_);
+        std::string sql = "SELECT pagetype, count(*) FROM dbstat WHERE name = '" + table + "' GROUP BY pagetype";
+        if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cout << "  dbstat unavailable (build SQLite with SQLITE_ENABLE_DBSTAT_VTAB)" << std::endl;
+            return;
+        }
+        std::map<std::string, sqlite3_int64> pages;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            pages[reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))] = sqlite3_column_int64(stmt, 1);
+        }
+        sqlite3_finalize(stmt);
+        std::cout << "  pages leaf=" << pages["leaf"] << " interior=" << pages["internal"]
+                  << " overflow=" << pages["overflow"] << " page_size=" << pragmaInt("page_size") << std::endl;
+    }
+
+    // Churns the table for --age_ops operations (default --num), in
+    // transactions of 1000: a third each of deletes and updates of random live
+    // rows from |keys|, and inserts of new random keys. Updates change the
+    // value size (drawn from --value_size_dist, or uniformly between half and
+    // twice --value_size), so cells move between pages and overflow chains come
+    // and go, as in a long-lived database.
+    void ageDatabase(std::vector<int64_t>& keys, bool silent) {
+        const int ops = age_ops_ > 0 ? age_ops_ : num_entries_;
+        sqlite3_stmt* insert;
+        sqlite3_stmt* update;
+        sqlite3_stmt* remove;
+        std::string insert_sql = schema_.insertSql(true), update_sql = schema_.updateSql(),
+                    delete_sql = schema_.deleteSql();
+        CheckSqliteError(sqlite3_prepare_v2(db_, insert_sql.c_str(), -1, &insert, nullptr), "prepare insert", db_);
+        CheckSqliteError(sqlite3_prepare_v2(db_, update_sql.c_str(), -1, &update, nullptr), "prepare update", db_);
+        CheckSqliteError(sqlite3_prepare_v2(db_, delete_sql.c_str(), -1, &remove, nullptr), "prepare delete", db_);
 
-        std::vector<char> value_buffer(value_size_, 'x');
+        ValueGenerator values = makeValues('a', rng_());
+        ValueGenerator updates(2 * value_size_, compression_ratio_, 'u', rng_());
+        std::uniform_int_distribution<int> update_size(std::max(1, value_size_ / 2), 2 * value_size_);
+        std::uniform_int_distribution<int64_t> new_key(0, num_entries_ * 10);
+        std::uniform_int_distribution<int> op_dist(0, 2);
+        uint64_t inserts = 0, deletes = 0, updated = 0;
         auto start = std::chrono::high_resolution_clock::now();
 
-        CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
-        for (int i = 0; i < num_entries_; ++i) {
-            sqlite3_bind_int(stmt, 1, i);
-            sqlite3_bind_blob(stmt, 2, value_buffer.data(), value_size_, SQLITE_STATIC);
-            if (sqlite3_step(stmt) != SQLITE_DONE) {
-                CheckSqliteError(SQLITE_ERROR, "step insert", db_);
+        for (int i = 0; i < ops; ++i) {
+            if (i % 1000 == 0) {
+                if (i) CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+                CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
+            }
+            int op = keys.empty() ? 0 : op_dist(rng_);
+            if (op == 0) {
+                int64_t key = new_key(rng_);
+                schema_.bindRow(insert, key, values.nextValue());
+                if (sqlite3_step(insert) != SQLITE_DONE) CheckSqliteError(SQLITE_ERROR, "step insert", db_);
+                sqlite3_reset(insert);
+                keys.push_back(key);
+                ++inserts;
+                continue;
+            }
+            size_t victim = std::uniform_int_distribution<size_t>(0, keys.size() - 1)(rng_);
+            if (op == 1) {
+                schema_.bindKey(remove, keys[victim]);
+                if (sqlite3_step(remove) != SQLITE_DONE) CheckSqliteError(SQLITE_ERROR, "step delete", db_);
+                sqlite3_reset(remove);
+                keys[victim] = keys.back();
+                keys.pop_back();
+                ++deletes;
+            } else {
+                ValueGenerator::Value value = value_sizes_ ? values.nextValue()
+                                                           : ValueGenerator::Value{updates.next(), update_size(rng_)};
+                schema_.bindValue(update, 1, value.data, value.size);
+                schema_.bindKey(update, keys[victim], 1 + schema_.valueColumnCount());
+                if (sqlite3_step(update) != SQLITE_DONE) CheckSqliteError(SQLITE_ERROR, "step update", db_);
+                sqlite3_reset(update);
+                ++updated;
             }
-            sqlite3_reset(stmt);
         }
-        CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+        if (ops > 0) CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
 
         auto end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> elapsed = end - start;
 
-        sqlite3_finalize(stmt);
-        
-        if (!silent) {
-            report("fillseq", num_entries_, elapsed.count());
+        sqlite3_finalize(insert);
+        sqlite3_finalize(update);
+        sqlite3_finalize(remove);
+        if (silent) {
+            ResetVfsStats();
+            return;
         }
+        report("age", ops, elapsed.count());
+        std::cout << "  inserts=" << inserts << " deletes=" << deletes << " updates=" << updated << std::endl;
     }
 
-    void fillRandom(bool silent = false) {
-        sqlite3_stmt* stmt;
-        const char* sql = "INSERT INTO test (key, value) VALUES (?, ?)";
-        CheckSqliteError(sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr), "prepare insert", db_);
-
-        std::vector<char> value_buffer(value_size_, 'x');
-        std::uniform_int_distribution<int64_t> dist(0, num_entries_ * 10);
-        auto start = std::chrono::high_resolution_clock::now();
-
+    // Maintenance on an aged database: fill, age (see ageDatabase()), then
+    // delete --vacuum_purge_pct percent of the rows, like a retention purge.
+    //   vacuum              VACUUM rebuilds the file in place
+    //   vacuum_into         VACUUM INTO writes a compacted copy next to it
+    //   incremental_vacuum  with auto_vacuum=INCREMENTAL (set before the
+    //                       load), PRAGMA incremental_vacuum(--vacuum_step_pages)
+    //                       until the freelist is empty
+    // ops/sec counts pages processed. A second connection performs random
+    // point reads throughout, and its latency is printed next to a baseline
+    // taken just before. readseq and readrandom run before (@aged) and after
+    // (@vacuumed) maintenance that changes the live file.
+    void vacuum(const std::string& mode) {
+        const bool incremental = mode == "incremental_vacuum";
+        if (incremental) {
+            execAll({"PRAGMA auto_vacuum=INCREMENTAL", "VACUUM"});
+        }
+        std::vector<int64_t> keys;
+        fillRandom(true, &keys);
+        ageDatabase(keys, true);
+        std::shuffle(keys.begin(), keys.end(), rng_);
+        size_t purge = keys.size() * vacuum_purge_pct_ / 100;
+        sqlite3_stmt* remove;
+        std::string delete_sql = schema_.deleteSql();
+        CheckSqliteError(sqlite3_prepare_v2(db_, delete_sql.c_str(), -1, &remove, nullptr), "prepare delete", db_);
         CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
-        for (int i = 0; i < num_entries_; ++i) {
-            sqlite3_bind_int64(stmt, 1, dist(rng_));
-            sqlite3_bind_blob(stmt, 2, value_buffer.data(), value_size_, SQLITE_STATIC);
-            sqlite3_step(stmt);
-            sqlite3_reset(stmt);
+        for (size_t i = 0; i < purge; ++i) {
+            schema_.bindKey(remove, keys.back());
+            keys.pop_back();
+            sqlite3_step(remove);
+            sqlite3_reset(remove);
         }
         CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
+        sqlite3_finalize(remove);
+        ResetVfsStats();
 
-        auto end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> elapsed = end - start;
-        
-        sqlite3_finalize(stmt);
-        
-        if (!silent) {
-            report("fillrandom", num_entries_, elapsed.count());
+        printBtreeStats("aged");
+        if (mode != "vacuum_into") {
+            name_suffix_ = "@aged";
+            readSequential();
+            readRandom();
+            name_suffix_.clear();
+        }
+
+        const sqlite3_int64 page_size = pragmaInt("page_size");
+        const sqlite3_int64 pages_before = pragmaInt("page_count");
+        const sqlite3_int64 free_before = pragmaInt("freelist_count");
+        std::string into_path;
+        sqlite3_int64 pages_after = 0;
+        LatencyRecorder steps;
+        auto bind_key = [this, &keys](sqlite3_stmt* stmt, std::mt19937_64& rng) {
+            schema_.bindKey(stmt, keys[rng() % keys.size()]);
+        };
+        double elapsed = withForegroundReads(keys.empty() ? "" : schema_.selectSql(), bind_key,
+                                             std::min(num_entries_, 20000), [&] {
+            if (mode == "vacuum") {
+                execAll({"VACUUM"});
+            } else if (mode == "vacuum_into") {
+                into_path = (db_path_ == ":memory:" || isUri() ? "/tmp/sqlite_benchmark" : db_path_) + ".vacuum";
+                unlink(into_path.c_str());
+                execAll({"VACUUM INTO '" + into_path + "'"});
+            } else {
+                const std::string step = "PRAGMA incremental_vacuum(" + std::to_string(vacuum_step_pages_) + ")";
+                while (pragmaInt("freelist_count") > 0) {
+                    auto step_start = std::chrono::high_resolution_clock::now();
+                    execAll({step});
+                    steps.add(std::chrono::high_resolution_clock::now() - step_start);
+                }
+            }
+        });
+        if (mode == "vacuum_into") {
+            struct stat st;
+            pages_after = stat(into_path.c_str(), &st) == 0 ? st.st_size / page_size : 0;
+            unlink(into_path.c_str());
+        } else {
+            pages_after = pragmaInt("page_count");
+        }
+
+        const double reclaimed_mb = static_cast<double>(pages_before - pages_after) * page_size / 1048576.0;
+        report(mode, static_cast<int>(incremental ? free_before : pages_before), elapsed);
+        std::cout << std::fixed << std::setprecision(1) << "  pages_before=" << pages_before
+                  << " freelist_before=" << free_before << " pages_after=" << pages_after
+                  << " reclaimed_mb=" << reclaimed_mb << " reclaim_mb_per_sec=" << reclaimed_mb / elapsed << std::endl;
+        if (incremental) std::cout << "  step latency " << steps.summary() << std::endl;
+        if (mode != "vacuum_into") {
+            printBtreeStats("vacuumed");
+            name_suffix_ = "@vacuumed";
+            readSequential();
+            readRandom();
+            name_suffix_.clear();
         }
     }
 
-    void readRandom() {
-        sqlite3_stmt* stmt;
-        const char* sql = "SELECT value FROM test WHERE key = ?";
-        CheckSqliteError(sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr), "prepare select", db_);
-        
-        std::uniform_int_distribution<int64_t> dist(0, num_entries_ - 1);
-        int found_count = 0;
+    // Runs |maintenance| on this connection while another one repeatedly runs
+    // the query |sql|, with parameters bound by |bind|, and returns the
+    // maintenance time in seconds. Prints the reader's latency during
+    // maintenance and, as a baseline, for |baseline_queries| of the same
+    // queries just before. An empty |sql| runs without the reader, as does a
+    // :memory: database, which cannot be shared.
+    template <typename Fn>
+    double withForegroundReads(const std::string& sql,
+                               const std::function<void(sqlite3_stmt*, std::mt19937_64&)>& bind,
+                               uint64_t baseline_queries, Fn maintenance) {
+        sqlite3* reader = nullptr;
+        if (db_path_ != ":memory:" && !sql.empty()) {
+            reader = openConnection();
+            applyPragmas(reader);
+            sqlite3_busy_timeout(reader, 10000);
+        }
+        std::atomic<bool> done{false};
+        LatencyRecorder baseline, during;
+        uint64_t reads = 0, errors = 0;
+        auto read_loop = [&](LatencyRecorder& latency, auto until) {
+            sqlite3_stmt* stmt;
+            CheckSqliteError(sqlite3_prepare_v2(reader, sql.c_str(), -1, &stmt, nullptr), "prepare " + sql, reader);
+            std::mt19937_64 rng(num_entries_);
+            for (uint64_t i = 0; !until(i); ++i) {
+                auto op_start = std::chrono::high_resolution_clock::now();
+                bind(stmt, rng);
+                int rc;
+                while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+                }
+                sqlite3_reset(stmt);
+                latency.add(std::chrono::high_resolution_clock::now() - op_start);
+                if (&latency == &during) {
+                    ++reads;
+                    if (rc != SQLITE_DONE) ++errors;
+                }
+            }
+            sqlite3_finalize(stmt);
+        };
+        if (reader) read_loop(baseline, [&](uint64_t i) { return i >= baseline_queries; });
+
+        sqlite3_busy_timeout(db_, 10000);
+        std::thread foreground;
+        if (reader) foreground = std::thread([&] { read_loop(during, [&](uint64_t) { return done.load(); }); });
         auto start = std::chrono::high_resolution_clock::now();
+        maintenance();
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+        done = true;
+        if (foreground.joinable()) foreground.join();
+        sqlite3_busy_timeout(db_, 0);
 
-        for (int i = 0; i < num_entries_; ++i) {
-            sqlite3_bind_int64(stmt, 1, dist(rng_));
-            if (sqlite3_step(stmt) == SQLITE_ROW) {
-                found_count++;
-            }
-            sqlite3_reset(stmt);
+        if (reader) {
+            sqlite3_close(reader);
+            std::cout << "  foreground baseline " << baseline.summary() << std::endl;
+            std::cout << "  foreground during " << during.summary() << " reads=" << reads << " errors=" << errors
+                      << std::endl;
+        } else if (!sql.empty()) {
+            std::cout << "  foreground reads skipped (:memory: cannot be shared)" << std::endl;
         }
+        return elapsed.count();
+    }
 
-        auto end = std::chrono::high_resolution_clock::now();
-        std::chrono::duration<double> elapsed = end - start;
-
+    // With --dbstat_report, prints one line per table and index after the load
+    // phase |phase|: B-tree depth, pages per level (root first), how full the
+    // B-tree pages are, overflow pages and unused bytes. dbstat reads every
+    // page, which takes time and warms the caches for whatever runs next in the
+    // process, so this is off by default. Depth comes from dbstat's path
+    // column, which has one '/'-separated component per level ("/", "/000/",
+    // "/000/01f/", ...).
+    void printDbstatReport(const std::string& phase) {
+        if (!dbstat_report_) return;
+        struct Tree {
+            std::vector<sqlite3_int64> levels;
+            sqlite3_int64 overflow = 0, bytes = 0, btree_unused = 0, unused = 0, cells = 0;
+        };
+        sqlite3_stmt* stmt;
+        const char* sql = "SELECT name, path, pagetype, ncell, pgsize, unused FROM dbstat";
+        if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cout << "  dbstat unavailable (build SQLite with SQLITE_ENABLE_DBSTAT_VTAB)" << std::endl;
+            return;
+        }
+        std::map<std::string, Tree> trees;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            Tree& tree = trees[reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0))];
+            const std::string type = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+            const sqlite3_int64 pgsize = sqlite3_column_int64(stmt, 4), unused = sqlite3_column_int64(stmt, 5);
+            tree.unused += unused;
+            if (type == "overflow") {
+                ++tree.overflow;
+                continue;
+            }
+            const char* path = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            size_t depth = std::count(path, path + strlen(path), '/');
+            if (tree.levels.size() < depth) tree.levels.resize(depth);
+            ++tree.levels[depth - 1];
+            tree.bytes += pgsize;
+            tree.btree_unused += unused;
+            tree.cells += sqlite3_column_int64(stmt, 3);
+        }
         sqlite3_finalize(stmt);
-        report("readrandom", num_entries_, elapsed.count());
+        for (const auto& [name, tree] : trees) {
+            if (name == "sqlite_schema" || name == "sqlite_master") continue;
+            sqlite3_int64 pages = 0;
+            std::string levels;
+            for (size_t i = 0; i < tree.levels.size(); ++i) {
+                pages += tree.levels[i];
+                levels += (i ? "/" : "") + std::to_string(tree.levels[i]);
+            }
+            std::cout << "  dbstat[" << phase << "] " << name << ": depth=" << tree.levels.size()
+                      << " pages=" << pages << " levels=" << levels << " cells=" << tree.cells << std::fixed
+                      << std::setprecision(1)
+                      << " fill=" << (tree.bytes ? 100.0 * (tree.bytes - tree.btree_unused) / tree.bytes : 0.0)
+                      << "% overflow=" << tree.overflow << " unused_kb=" << tree.unused / 1024.0 << std::endl;
+        }
     }
 
-    // --- MODIFIED: Added new readSequential benchmark function ---
-    void readSequential() {
+    // Prints the file's page and freelist counts and, from dbstat, how full
+    // the table's leaf pages are and how often the next leaf in key order is
+    // not the next page in the file (leaf_fragmentation).
+    void printBtreeStats(const std::string& label) {
+        std::cout << "  btree[" << label << "] pages=" << pragmaInt("page_count")
+                  << " freelist=" << pragmaInt("freelist_count");
         sqlite3_stmt* stmt;
-        const char* sql = "SELECT key, value FROM test ORDER BY key";
-        CheckSqliteError(sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr), "prepare select", db_);
-        
-        int found_count = 0;
-        auto start = std::chrono::high_resolution_clock::now();
-
+        const char* sql = "SELECT pageno, pgsize, unused FROM dbstat WHERE name = 'test' AND pagetype = 'leaf'";
+        if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+            std::cout << " (dbstat unavailable)" << std::endl;
+            return;
+        }
+        sqlite3_int64 leaves = 0, jumps = 0, bytes = 0, unused = 0, prev = -1;
         while (sqlite3_step(stmt) == SQLITE_ROW) {
-            found_count++;
+            sqlite3_int64 pageno = sqlite3_column_int64(stmt, 0);
+            if (prev >= 0 && pageno != prev + 1) ++jumps;
+            prev = pageno;
+            bytes += sqlite3_column_int64(stmt, 1);
+            unused += sqlite3_column_int64(stmt, 2);
+            ++leaves;
+        }
+        sqlite3_finalize(stmt);
+        std::cout << std::fixed << std::setprecision(1) << " leaves=" << leaves
+                  << " leaf_fill=" << (bytes ? 100.0 * (bytes - unused) / bytes : 0) << "%"
+                  << " leaf_fragmentation=" << (leaves > 1 ? 100.0 * jumps / (leaves - 1) : 0) << "%" << std::endl;
+    }
+
+    // Point queries through each configured secondary index in turn, reported
+    // as indexlookup_<kind>. Keys are drawn like readrandom's.
+    void indexLookup() {
+        std::vector<std::string> kinds;
+        for (const auto& kind : schema_.indexes()) {
+            if (std::find(kinds.begin(), kinds.end(), kind) == kinds.end()) kinds.push_back(kind);
+        }
+        if (kinds.empty()) {
+            std::cerr << "indexlookup: no secondary indexes; pass --indexes." << std::endl;
+            return;
+        }
+        for (const auto& kind : kinds) {
+            sqlite3_stmt* stmt;
+            std::string sql = schema_.lookupSql(kind);
+            CheckSqliteError(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr), "prepare lookup", db_);
+
+            std::uniform_int_distribution<int64_t> dist(0, num_entries_ - 1);
+            int found_count = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+
+            for (int i = 0; i < num_entries_; ++i) {
+                schema_.bindLookup(stmt, kind, dist(rng_));
+                while (sqlite3_step(stmt) == SQLITE_ROW) {
+                    found_count++;
+                }
+                sqlite3_reset(stmt);
+            }
+
+            auto end = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double> elapsed = end - start;
+
+            sqlite3_finalize(stmt);
+            report("indexlookup_" + kind, num_entries_, elapsed.count());
+            std::cout << "  found=" << found_count << std::endl;
+        }
+    }
+
+    // Builds every configured index on the loaded table. ops/sec counts rows
+    // indexed (rows x indexes); PRAGMA threads lets SQLite's sorter use
+    // --sorter_threads helper threads.
+    void createIndex() {
+        if (schema_.indexes().empty()) {
+            std::cerr << "createindex: no secondary indexes; pass --indexes." << std::endl;
+            return;
         }
+        const sqlite3_int64 saved_threads = pragmaInt("threads");
+        std::string threads_sql = "PRAGMA threads=" + std::to_string(sorter_threads_);
+        CheckSqliteError(sqlite3_exec(db_, threads_sql.c_str(), 0, 0, 0), threads_sql, db_);
+        const sqlite3_int64 sorter_threads = pragmaInt("threads");
+        const sqlite3_int64 rows = countRows();
 
+        std::ostringstream times;
+        times << std::fixed << std::setprecision(3);
+        const std::vector<std::string> statements = schema_.indexSql();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < statements.size(); ++i) {
+            auto index_start = std::chrono::high_resolution_clock::now();
+            CheckSqliteError(sqlite3_exec(db_, statements[i].c_str(), 0, 0, 0), statements[i], db_);
+            std::chrono::duration<double> index_elapsed = std::chrono::high_resolution_clock::now() - index_start;
+            times << " " << schema_.indexes()[i] << "=" << index_elapsed.count() << "s";
+        }
         auto end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> elapsed = end - start;
 
+        threads_sql = "PRAGMA threads=" + std::to_string(saved_threads);
+        CheckSqliteError(sqlite3_exec(db_, threads_sql.c_str(), 0, 0, 0), threads_sql, db_);
+        report("createindex", static_cast<int>(rows * statements.size()), elapsed.count());
+        std::cout << "  rows=" << rows << " sorter_threads=" << sorter_threads << times.str() << std::endl;
+    }
+
+    sqlite3_int64 countRows() {
+        sqlite3_stmt* stmt;
+        CheckSqliteError(sqlite3_prepare_v2(db_, "SELECT count(*) FROM test", -1, &stmt, nullptr), "prepare count", db_);
+        sqlite3_int64 rows = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
         sqlite3_finalize(stmt);
-        report("readseq", found_count, elapsed.count());
+        return rows;
     }
 
-    void readWrite() {
+    // Application-style workload that survives errors: a 50/50 mix of point
+    // reads and single-row autocommit writes, where every failed operation is
+    // rolled back and retried with exponential backoff. Run it through the
+    // faults VFS to see what injected errors cost in throughput and tail latency.
+    void resilience() {
         sqlite3_stmt* read_stmt;
-        const char* read_sql = "SELECT value FROM test WHERE key = ?";
-        CheckSqliteError(sqlite3_prepare_v2(db_, read_sql, -1, &read_stmt, nullptr), "prepare read", db_);
-        
+        std::string read_sql = schema_.selectSql();
+        CheckSqliteError(sqlite3_prepare_v2(db_, read_sql.c_str(), -1, &read_stmt, nullptr), "prepare read", db_);
+
         sqlite3_stmt* write_stmt;
-        const char* write_sql = "INSERT OR REPLACE INTO test (key, value) VALUES (?, ?)";
-        CheckSqliteError(sqlite3_prepare_v2(db_, write_sql, -1, &write_stmt, nullptr), "prepare write", db_);
+        std::string write_sql = schema_.insertSql(true);
+        CheckSqliteError(sqlite3_prepare_v2(db_, write_sql.c_str(), -1, &write_stmt, nullptr), "prepare write", db_);
 
         std::uniform_int_distribution<int64_t> key_dist(0, num_entries_ - 1);
         std::uniform_int_distribution<int> op_dist(0, 1);
-        std::vector<char> value_buffer(value_size_, 'y');
+        ValueGenerator values = makeValues('y', rng_());
+        LatencyRecorder latency;
+        latency.reserve(num_entries_);
+        uint64_t busy = 0, ioerr = 0, full = 0, corrupt = 0, other = 0;
+        uint64_t retries = 0, rollbacks = 0, failed_ops = 0, recovered_ops = 0;
+        std::chrono::duration<double> recovery_time(0);
         auto start = std::chrono::high_resolution_clock::now();
 
-        CheckSqliteError(sqlite3_exec(db_, "BEGIN TRANSACTION", 0, 0, 0), "begin transaction", db_);
         for (int i = 0; i < num_entries_; ++i) {
             int64_t key = key_dist(rng_);
-            if (op_dist(rng_) == 0) {
-                sqlite3_bind_int64(read_stmt, 1, key);
-                sqlite3_step(read_stmt);
-                sqlite3_reset(read_stmt);
-            } else {
-                sqlite3_bind_int64(write_stmt, 1, key);
-                sqlite3_bind_blob(write_stmt, 2, value_buffer.data(), value_size_, SQLITE_STATIC);
-                sqlite3_step(write_stmt);
-                sqlite3_reset(write_stmt);
+            bool is_read = op_dist(rng_) == 0;
+            auto op_start = std::chrono::high_resolution_clock::now();
+            std::chrono::high_resolution_clock::time_point first_failure;
+            for (int attempt = 0;; ++attempt) {
+                sqlite3_stmt* stmt = is_read ? read_stmt : write_stmt;
+                if (is_read) {
+                    schema_.bindKey(stmt, key);
+                } else {
+                    schema_.bindRow(stmt, key, values.nextValue());
+                }
+                int rc = sqlite3_step(stmt);
+                sqlite3_reset(stmt);
+                if (rc == SQLITE_ROW || rc == SQLITE_DONE) {
+                    if (attempt > 0) {
+                        ++recovered_ops;
+                        recovery_time += std::chrono::high_resolution_clock::now() - first_failure;
+                    }
+                    break;
+                }
+                if (attempt == 0) {
+                    first_failure = std::chrono::high_resolution_clock::now();
+                }
+                switch (rc & 0xff) {
+                    case SQLITE_BUSY: ++busy; break;
+                    case SQLITE_IOERR: ++ioerr; break;
+                    case SQLITE_FULL: ++full; break;
+                    case SQLITE_CORRUPT: ++corrupt; break;
+                    default: ++other; break;
+                }
+                if (!sqlite3_get_autocommit(db_)) {
+                    sqlite3_exec(db_, "ROLLBACK", 0, 0, 0);
+                    ++rollbacks;
+                }
+                if (attempt == max_retries_) {
+                    ++failed_ops;
+                    break;
+                }
+                ++retries;
+                std::this_thread::sleep_for(std::chrono::microseconds(
+                    static_cast<int64_t>(retry_backoff_us_) << std::min(attempt, 16)));
             }
+            latency.add(std::chrono::high_resolution_clock::now() - op_start);
         }
-        CheckSqliteError(sqlite3_exec(db_, "COMMIT", 0, 0, 0), "commit transaction", db_);
 
         auto end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> elapsed = end - start;
 
         sqlite3_finalize(read_stmt);
         sqlite3_finalize(write_stmt);
-        report("readwrite", num_entries_, elapsed.count());
+        report("resilience", num_entries_, elapsed.count());
+        std::cout << "  latency " << latency.summary() << std::endl;
+        std::cout << "  errors busy=" << busy << " ioerr=" << ioerr << " full=" << full << " corrupt=" << corrupt
+                  << " other=" << other << " retries=" << retries << " rollbacks=" << rollbacks
+                  << " failed_ops=" << failed_ops << " recovered_ops=" << recovered_ops << " avg_recovery_us="
+                  << std::fixed << std::setprecision(1)
+                  << (recovered_ops ? recovery_time.count() * 1e6 / recovered_ops : 0.0) << std::endl;
+    }
+
+    // Random point reads from --threads threads, each with its own connection.
+    // With |with_writer|, one more thread overwrites random keys until the
+    // readers finish; only reads count towards ops/sec.
+    void readRandomMultiThreaded(bool with_writer) {
+        const char* name = with_writer ? "readwhilewriting" : "readrandom_mt";
+        if (db_path_ == ":memory:") {
+            std::cerr << name << ": a :memory: database is private to one connection; use a shared one such as "
+                      << "--db_path=file:/bench?vfs=memdb or --vfs=ram." << std::endl;
+            return;
+        }
+        const int per_thread = std::max(1, num_entries_ / threads_);
+        std::vector<sqlite3*> conns;
+        for (int t = 0; t < threads_ + (with_writer ? 1 : 0); ++t) {
+            sqlite3* conn = openConnection();
+            applyPragmas(conn);
+            sqlite3_busy_timeout(conn, 10000);
+            conns.push_back(conn);
+        }
+
+        std::vector<LatencyRecorder> latencies(threads_);
+        std::atomic<uint64_t> found{0}, read_errors{0}, writes{0}, write_errors{0};
+        std::atomic<bool> stop{false};
+        std::vector<std::thread> workers;
+        auto start = std::chrono::high_resolution_clock::now();
+
+        for (int t = 0; t < threads_; ++t) {
+            uint64_t seed = rng_();
+            workers.emplace_back([&, t, seed] {
+                sqlite3* conn = conns[t];
+                sqlite3_stmt* stmt;
+                CheckSqliteError(sqlite3_prepare_v2(conn, schema_.selectSql().c_str(), -1, &stmt, nullptr),
+                                 "prepare select", conn);
+                std::mt19937_64 rng(seed);
+                std::uniform_int_distribution<int64_t> dist(0, num_entries_ - 1);
+                latencies[t].reserve(per_thread);
+                for (int i = 0; i < per_thread; ++i) {
+                    auto op_start = std::chrono::high_resolution_clock::now();
+                    schema_.bindKey(stmt, dist(rng));
+                    int rc = sqlite3_step(stmt);
+                    if (rc == SQLITE_ROW) {
+                        ++found;
+                    } else if (rc != SQLITE_DONE) {
+                        ++read_errors;
+                    }
+                    sqlite3_reset(stmt);
+                    latencies[t].add(std::chrono::high_resolution_clock::now() - op_start);
+                }
+                sqlite3_finalize(stmt);
+            });
+        }
+        std::thread writer;
+        if (with_writer) {
+            uint64_t seed = rng_();
+            writer = std::thread([&, seed] {
+                sqlite3* conn = conns.back();
+                sqlite3_stmt* stmt;
+                CheckSqliteError(sqlite3_prepare_v2(conn, schema_.insertSql(true).c_str(), -1, &stmt, nullptr),
+                                 "prepare write", conn);
+                std::mt19937_64 rng(seed);
+                std::uniform_int_distribution<int64_t> dist(0, num_entries_ - 1);
+                ValueGenerator values = makeValues('y', seed);
+                while (!stop) {
+                    schema_.bindRow(stmt, dist(rng), values.nextValue());
+                    if (sqlite3_step(stmt) == SQLITE_DONE) {
+                        ++writes;
+                    } else {
+                        ++write_errors;
+                    }
+                    sqlite3_reset(stmt);
+                }
+                sqlite3_finalize(stmt);
+            });
+        }
+        for (auto& w : workers) w.join();
+        stop = true;
+        if (writer.joinable()) writer.join();
+
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = end - start;
+
+        for (sqlite3* conn : conns) sqlite3_close(conn);
+        LatencyRecorder latency;
+        for (auto& l : latencies) latency.merge(l);
+        report(name, per_thread * threads_, elapsed.count());
+        std::cout << "  latency " << latency.summary() << std::endl;
+        std::cout << "  threads=" << threads_ << " found=" << found << " read_errors=" << read_errors;
+        if (with_writer) {
+            std::cout << " writes=" << writes << " writes_per_sec=" << std::fixed << std::setprecision(2)
+                      << writes / elapsed.count() << " write_errors=" << write_errors;
+        }
+        std::cout << std::endl;
     }
 };
 
 // --- Main Function ---
 
+std::vector<double> ParseFractions(const std::string& list, const std::string& flag) {
+    std::vector<double> fractions;
+    for (const auto& item : split(list, ',')) {
+        char* end = nullptr;
+        double f = std::strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0' || f < 0) {
+            std::cerr << "Invalid --" << flag << " value '" << item << "'." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        fractions.push_back(f);
+    }
+    return fractions;
+}
+
 int main(int argc, char** argv) {
     cxxopts::Options options("sqlite_benchmark", "A flexible C++ benchmark for SQLite3");
 
     options.add_options()
         ("b,benchmarks", "Comma-separated list of benchmarks to run (e.g., fillseq,readrandom)", cxxopts::value<std::string>()->default_value("fillrandom,readrandom"))
-        ("d,db_path", "Path to the database file or :memory:", cxxopts::value<std::string>()->default_value("/tmp/test.db"))
+        ("d,db_path", "Path to the database file, :memory:, or a URI such as file:/bench?vfs=memdb", cxxopts::value<std::string>()->default_value("/tmp/test.db"))
         ("n,num", "Number of entries for the benchmark", cxxopts::value<int>()->default_value("100000"))
         ("v,value_size", "Size of each value in bytes", cxxopts::value<int>()->default_value("100"))
+        ("value_size_dist", "Value size distribution: fixed, uniform, normal, lognormal, pareto or empirical:<file> (lines of 'size [weight]')", cxxopts::value<std::string>()->default_value("fixed"))
+        ("value_size_min", "Smallest value size drawn from --value_size_dist", cxxopts::value<int>()->default_value("1"))
+        ("value_size_max", "Largest value size drawn from --value_size_dist (0 = 8 x --value_size)", cxxopts::value<int>()->default_value("0"))
+        ("value_size_sigma", "normal: standard deviation as a fraction of --value_size; lognormal: standard deviation of ln(size)", cxxopts::value<double>()->default_value("0.5"))
+        ("value_size_alpha", "pareto: shape parameter (> 1)", cxxopts::value<double>()->default_value("1.5"))
+        ("compression_ratio", "Generate values that compress to this fraction of their size (0 = constant filler bytes)", cxxopts::value<double>()->default_value("0"))
         ("p,pragmas", "Comma-separated list of PRAGMA commands (e.g., 'journal_mode=WAL,synchronous=NORMAL')", cxxopts::value<std::string>()->default_value(""))
+        ("vfs", "Comma-separated VFS layers, outermost first (e.g., io_uring), or 'default'", cxxopts::value<std::string>()->default_value("default"))
+        ("uring_depth", "io_uring VFS: submission queue depth", cxxopts::value<unsigned>()->default_value("64"))
+        ("uring_readahead", "io_uring VFS: pages to prefetch during sequential scans (0 disables)", cxxopts::value<int>()->default_value("16"))
+        ("odirect_align", "odirect VFS: O_DIRECT buffer and offset alignment in bytes", cxxopts::value<size_t>()->default_value("4096"))
+        ("latency_read_us", "latency VFS: mean delay per read in microseconds", cxxopts::value<double>()->default_value("0"))
+        ("latency_write_us", "latency VFS: mean delay per write in microseconds", cxxopts::value<double>()->default_value("0"))
+        ("latency_sync_us", "latency VFS: mean delay per sync in microseconds", cxxopts::value<double>()->default_value("0"))
+        ("latency_dist", "latency VFS: delay distribution (fixed, uniform, exponential, lognormal)", cxxopts::value<std::string>()->default_value("fixed"))
+        ("latency_sigma", "latency VFS: shape parameter of the lognormal distribution", cxxopts::value<double>()->default_value("0.5"))
+        ("latency_jitter_us", "latency VFS: extra uniform jitter in microseconds", cxxopts::value<double>()->default_value("0"))
+        ("latency_bandwidth_mbps", "latency VFS: link bandwidth in MB/s shared by all transfers (0 = unlimited)", cxxopts::value<double>()->default_value("0"))
+        ("latency_seed", "latency VFS: seed for the delay stream", cxxopts::value<uint64_t>()->default_value("1"))
+        ("fault_busy_prob", "faults VFS: probability that a lock attempt returns SQLITE_BUSY", cxxopts::value<double>()->default_value("0"))
+        ("fault_ioerr_prob", "faults VFS: probability that a read, write or sync returns SQLITE_IOERR", cxxopts::value<double>()->default_value("0"))
+        ("fault_short_read_prob", "faults VFS: probability that a read comes back short", cxxopts::value<double>()->default_value("0"))
+        ("fault_full_prob", "faults VFS: probability that a write returns SQLITE_FULL", cxxopts::value<double>()->default_value("0"))
+        ("fault_seed", "faults VFS: seed for the fault stream", cxxopts::value<uint64_t>()->default_value("1"))
+        ("compress_codec", "compress VFS: page codec (zlib, lz4, zstd)", cxxopts::value<std::string>()->default_value("zlib"))
+        ("compress_level", "compress VFS: codec compression level (-1 = codec default)", cxxopts::value<int>()->default_value("-1"))
+        ("mmap_advice", "mmap VFS: madvise for SQLite's memory map (normal, random, sequential, willneed, hugepage, prefault)", cxxopts::value<std::string>()->default_value("normal"))
+        ("cksum_algo", "cksum VFS: page checksum (cksumvfs = SQLite's extension format, simd = 8-lane vectorized)", cxxopts::value<std::string>()->default_value("simd"))
+        ("cksum_verify", "cksum VFS: verify checksums on read", cxxopts::value<bool>()->default_value("true"))
+        ("coalesce_max_kb", "coalesce VFS: largest write built from adjacent writes, in KB (max 127)", cxxopts::value<size_t>()->default_value("64"))
+        ("ramcache_mb", "ramcache VFS: memory limit of the secondary read cache in MB", cxxopts::value<size_t>()->default_value("256"))
+        ("ramcache_codec", "ramcache VFS: compress cached pages with this codec (none, zlib, lz4, zstd)", cxxopts::value<std::string>()->default_value("none"))
+        ("max_retries", "resilience, tpcb, tpcc: retries per operation or transaction before it counts as failed", cxxopts::value<int>()->default_value("10"))
+        ("retry_backoff_us", "resilience benchmark: initial retry backoff in microseconds, doubled per retry", cxxopts::value<int>()->default_value("100"))
+        ("schema", "Table key type: int (rowid alias), text (prefixed string), uuid, blob or composite (grp, key)", cxxopts::value<std::string>()->default_value("int"))
+        ("without_rowid", "Create the table WITHOUT ROWID (clustered on its primary key)", cxxopts::value<bool>()->default_value("false"))
+        ("key_size", "Key length in bytes for --schema=text and blob (blob needs at least 8)", cxxopts::value<int>()->default_value("16"))
+        ("value_columns", "Split each value across this many BLOB columns", cxxopts::value<int>()->default_value("1"))
+        ("indexes", "Secondary indexes on key-derived columns: a comma-separated list of plain, covering, partial and expression (repeats allowed), or a count N for the first N of that cycle", cxxopts::value<std::string>()->default_value(""))
+        ("sorter_threads", "createindex/bulkload: PRAGMA threads for SQLite's multi-threaded sorter (0 = single-threaded); also bulkload's radix sort threads", cxxopts::value<int>()->default_value("4"))
+        ("bulkload_cache_mb", "bulkload: cache_size in MB while loading", cxxopts::value<int>()->default_value("1024"))
+        ("ingest_file", "gencsv/ingest: CSV file to write or import (tab-separated if it ends in .tsv); ingest generates it if missing", cxxopts::value<std::string>()->default_value("/tmp/sqlite_benchmark_ingest.csv"))
+        ("ingest_batch", "ingest: rows per parsed batch and per insert transaction", cxxopts::value<int>()->default_value("10000"))
+        ("ingest_rows_per_insert", "ingest: rows bound into each multi-row INSERT statement", cxxopts::value<int>()->default_value("64"))
+        ("export_file", "export: output path prefix; writes <prefix>.csv and <prefix>.bin", cxxopts::value<std::string>()->default_value("/tmp/sqlite_benchmark_export"))
+        ("export_buffer_kb", "export: output buffer size in KB", cxxopts::value<size_t>()->default_value("4096"))
+        ("blob_sizes", "blobio: comma-separated value sizes in bytes", cxxopts::value<std::string>()->default_value("4096,65536,1048576,4194304"))
+        ("blob_chunk", "blobio: bytes per sqlite3_blob_read/write call", cxxopts::value<int>()->default_value("65536"))
+        ("blob_mb", "blobio: MB written per size and method (capped at --num rows)", cxxopts::value<int>()->default_value("64"))
+        ("age_ops", "age: churn operations (random deletes, inserts and size-changing updates); 0 = --num", cxxopts::value<int>()->default_value("0"))
+        ("vacuum_purge_pct", "vacuum benchmarks: percent of rows deleted after aging, before maintenance", cxxopts::value<int>()->default_value("25"))
+        ("vacuum_step_pages", "incremental_vacuum: pages freed per PRAGMA incremental_vacuum(N) call", cxxopts::value<int>()->default_value("1000"))
+        ("analytics_reps", "analytics: runs of each query per phase", cxxopts::value<int>()->default_value("3"))
+        ("oltp_txns", "tpcb/tpcc: transactions per run (split across threads)", cxxopts::value<int>()->default_value("10000"))
+        ("sort_temp_store", "sort: comma-separated PRAGMA temp_store values to sweep (file, memory, default)", cxxopts::value<std::string>()->default_value("file,memory"))
+        ("sort_cache_mb", "sort: comma-separated page cache sizes in MB to sweep", cxxopts::value<std::string>()->default_value("2,64"))
+        ("sort_threads", "sort: comma-separated PRAGMA threads values to sweep", cxxopts::value<std::string>()->default_value("0,4"))
+        ("fts_vocab", "fts: distinct words in the generated vocabulary", cxxopts::value<int>()->default_value("50000"))
+        ("fts_zipf", "fts: Zipf exponent of word frequencies", cxxopts::value<double>()->default_value("1.0"))
+        ("fts_doc_words", "fts: words per document", cxxopts::value<int>()->default_value("100"))
+        ("fts_batch", "fts: comma-separated documents per transaction to sweep during ingestion", cxxopts::value<std::string>()->default_value("100,10000"))
+        ("fts_queries", "fts: queries of each kind per phase", cxxopts::value<int>()->default_value("1000"))
+        ("fts_merge_pages", "fts: pages of work per 'merge' step", cxxopts::value<int>()->default_value("500"))
+        ("json_format", "jsondoc: store documents as text or jsonb (SQLite 3.45+; falls back to text)", cxxopts::value<std::string>()->default_value("text"))
+        ("json_depth", "jsondoc: nested object levels per document", cxxopts::value<int>()->default_value("2"))
+        ("json_fields", "jsondoc: scalar fields per object", cxxopts::value<int>()->default_value("8"))
+        ("json_queries", "jsondoc: indexed queries of each kind (full scans run 1/100 as many)", cxxopts::value<int>()->default_value("1000"))
+        ("dbstat_report", "After each load phase, print per table/index B-tree depth, pages per level, fill and overflow from dbstat", cxxopts::value<bool>()->default_value("false"))
+        ("threads", "readrandom_mt/readwhilewriting: number of reader threads; ingest: number of parser threads; tpcb/tpcc: number of writer connections", cxxopts::value<int>()->default_value("4"))
+        ("mmap_fraction", "Comma-separated mmap_size values as fractions of the loaded DB size (e.g., 0.5,1.0,1.5); read benchmarks run once per value", cxxopts::value<std::string>()->default_value(""))
+        ("cache_fraction", "Comma-separated cache_size values as fractions of the loaded DB size; combined with --mmap_fraction", cxxopts::value<std::string>()->default_value(""))
         ("h,help", "Print usage");
 
     auto result = options.parse(argc, argv);
@@ -314,8 +6489,98 @@ int main(int argc, char** argv) {
     std::string pragmas = result["pragmas"].as<std::string>();
 
     std::vector<std::string> benchmarks_to_run = split(benchmarks_str, ',');
+    std::string key_type = result["schema"].as<std::string>();
+    int key_size = result["key_size"].as<int>();
+    if (!Schema::ValidKeyType(key_type)) {
+        std::cerr << "Unknown schema '" << key_type << "' (use int, text, uuid, blob or composite)." << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (key_type == "blob" && key_size < 8) {
+        std::cerr << "--key_size must be at least 8 for --schema=blob." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<std::string> indexes = split(result["indexes"].as<std::string>(), ',');
+    if (indexes.size() == 1 && !indexes[0].empty() && std::all_of(indexes[0].begin(), indexes[0].end(), ::isdigit)) {
+        static const char* kCycle[] = {"plain", "covering", "partial", "expression"};
+        int count = std::stoi(indexes[0]);
+        indexes.clear();
+        for (int i = 0; i < count; ++i) indexes.push_back(kCycle[i % 4]);
+    }
+    for (const auto& kind : indexes) {
+        if (!Schema::ValidIndexKind(kind)) {
+            std::cerr << "Unknown index kind '" << kind << "' (use plain, covering, partial or expression)." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::string vfs_name = SetupVfsStack(result["vfs"].as<std::string>(), result);
 
-    Benchmark bench(db_path, num_entries, value_size, pragmas);
+    Benchmark bench(db_path, num_entries, value_size, pragmas, vfs_name);
+    bench.setCompressionRatio(result["compression_ratio"].as<double>());
+    int value_size_min = std::max(1, result["value_size_min"].as<int>());
+    int value_size_max = result["value_size_max"].as<int>() > 0 ? result["value_size_max"].as<int>() : 8 * value_size;
+    if (value_size_max < value_size_min) {
+        std::cerr << "--value_size_max must not be below --value_size_min." << std::endl;
+        return EXIT_FAILURE;
+    }
+    bench.setValueSizes(ValueSizes::Make(result["value_size_dist"].as<std::string>(), value_size, value_size_min,
+                                         value_size_max, result["value_size_sigma"].as<double>(),
+                                         result["value_size_alpha"].as<double>(), 1));
+    bench.setRetryPolicy(result["max_retries"].as<int>(), result["retry_backoff_us"].as<int>());
+    bench.setThreads(result["threads"].as<int>());
+    Schema schema(key_type, result["without_rowid"].as<bool>(), key_size, result["value_columns"].as<int>(), value_size);
+    schema.setIndexes(indexes);
+    bench.setSchema(schema);
+    bench.setSorterThreads(result["sorter_threads"].as<int>());
+    bench.setBulkloadCache(result["bulkload_cache_mb"].as<int>());
+    bench.setExport(result["export_file"].as<std::string>(), result["export_buffer_kb"].as<size_t>() * 1024);
+    std::vector<int> blob_sizes;
+    for (const auto& item : split(result["blob_sizes"].as<std::string>(), ',')) {
+        char* end = nullptr;
+        long size = std::strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || size <= 0 || size > 1000000000) {
+            std::cerr << "Invalid --blob_sizes value '" << item << "'." << std::endl;
+            return EXIT_FAILURE;
+        }
+        blob_sizes.push_back(static_cast<int>(size));
+    }
+    bench.setBlobIo(blob_sizes, result["blob_chunk"].as<int>(), result["blob_mb"].as<int>());
+    bench.setAgeOps(result["age_ops"].as<int>());
+    bench.setVacuum(result["vacuum_purge_pct"].as<int>(), result["vacuum_step_pages"].as<int>());
+    bench.setDbstatReport(result["dbstat_report"].as<bool>());
+    bench.setAnalyticsReps(result["analytics_reps"].as<int>());
+    bench.setOltpTxns(result["oltp_txns"].as<int>());
+    std::vector<int> sort_cache_mb, sort_threads;
+    for (const auto& item : split(result["sort_cache_mb"].as<std::string>(), ',')) {
+        sort_cache_mb.push_back(std::max(1, std::atoi(item.c_str())));
+    }
+    for (const auto& item : split(result["sort_threads"].as<std::string>(), ',')) {
+        sort_threads.push_back(std::max(0, std::atoi(item.c_str())));
+    }
+    std::vector<std::string> sort_temp_stores = split(result["sort_temp_store"].as<std::string>(), ',');
+    for (const auto& temp_store : sort_temp_stores) {
+        if (temp_store != "file" && temp_store != "memory" && temp_store != "default") {
+            std::cerr << "Unknown --sort_temp_store value '" << temp_store << "' (use file, memory or default)." << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    bench.setSortSweep(sort_temp_stores, sort_cache_mb, sort_threads);
+    std::vector<int> fts_batches;
+    for (const auto& item : split(result["fts_batch"].as<std::string>(), ',')) {
+        fts_batches.push_back(std::max(1, std::atoi(item.c_str())));
+    }
+    const std::string json_format = result["json_format"].as<std::string>();
+    if (json_format != "text" && json_format != "jsonb") {
+        std::cerr << "Unknown --json_format '" << json_format << "' (use text or jsonb)." << std::endl;
+        return EXIT_FAILURE;
+    }
+    bench.setJson(json_format, std::max(0, result["json_depth"].as<int>()), std::max(0, result["json_fields"].as<int>()),
+                  result["json_queries"].as<int>());
+    bench.setFts(result["fts_vocab"].as<int>(), result["fts_zipf"].as<double>(), result["fts_doc_words"].as<int>(),
+                 fts_batches, result["fts_queries"].as<int>(), std::max(2, result["fts_merge_pages"].as<int>()));
+    bench.setIngest(result["ingest_file"].as<std::string>(), result["ingest_batch"].as<int>(),
+                    result["ingest_rows_per_insert"].as<int>());
+    bench.setSizeFractions(ParseFractions(result["mmap_fraction"].as<std::string>(), "mmap_fraction"),
+                           ParseFractions(result["cache_fraction"].as<std::string>(), "cache_fraction"));
     bench.run(benchmarks_to_run);
 
     return 0;